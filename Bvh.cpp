@@ -0,0 +1,99 @@
+#include "Bvh.h"
+
+// boxes per leaf before a node is split
+static const GLint leafSize = 4;
+
+/*
+* Builds the tree from scratch.
+*
+* lows, highs: corners of each box, referred to by index
+*/
+void Bvh::Build(const std::vector<glm::vec3>& lows, const std::vector<glm::vec3>& highs) {
+	GLint numBoxes = (GLint)lows.size();
+
+	nodes.clear();
+	items.resize(numBoxes);
+	for (GLint i = 0; i < numBoxes; i++) items[i] = i;
+	if (numBoxes == 0) return;
+
+	// a balanced tree over n boxes has fewer than 2n / leafSize nodes
+	nodes.reserve(2 * (numBoxes / leafSize + 1));
+	this->BuildNode(lows, highs, 0, numBoxes);
+}
+
+/*
+* Adds the node over items[first] up to items[first + count] and,
+* recursively, its children.
+*
+* returns: index of the new node
+*/
+GLint Bvh::BuildNode(const std::vector<glm::vec3>& lows, const std::vector<glm::vec3>& highs,
+	GLint first, GLint count) {
+	GLint index = (GLint)nodes.size();
+	nodes.push_back(Node());
+
+	glm::vec3 low = lows[items[first]], high = highs[items[first]];
+	glm::vec3 centerLow = 0.5f * (low + high), centerHigh = centerLow;
+	for (GLint i = first + 1; i < first + count; i++) {
+		GLint box = items[i];
+		low = glm::min(low, lows[box]);
+		high = glm::max(high, highs[box]);
+
+		glm::vec3 center = 0.5f * (lows[box] + highs[box]);
+		centerLow = glm::min(centerLow, center);
+		centerHigh = glm::max(centerHigh, center);
+	}
+	nodes[index].low = low;
+	nodes[index].high = high;
+
+	if (count <= leafSize) {
+		nodes[index].first = first;
+		nodes[index].count = count;
+		return index;
+	}
+
+	// split at the median box center along the axis the centers spread most
+	glm::vec3 spread = centerHigh - centerLow;
+	int axis = 0;
+	if (spread.y > spread[axis]) axis = 1;
+	if (spread.z > spread[axis]) axis = 2;
+
+	GLint half = count / 2;
+	std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+		[&lows, &highs, axis](GLint a, GLint b) {
+			return lows[a][axis] + highs[a][axis] < lows[b][axis] + highs[b][axis];
+		});
+
+	this->BuildNode(lows, highs, first, half);
+	GLint right = this->BuildNode(lows, highs, first + half, count - half);
+	nodes[index].first = right;
+	nodes[index].count = 0;
+	return index;
+}
+
+/*
+* Recomputes every node's bounds for boxes that moved, keeping the tree
+* as built. Children come after their parents, so one backwards sweep
+* sees every child before its parent.
+*
+* lows, highs: new corners of the same boxes Build was given
+*/
+void Bvh::Refit(const std::vector<glm::vec3>& lows, const std::vector<glm::vec3>& highs) {
+	for (GLint n = (GLint)nodes.size() - 1; n >= 0; n--) {
+		Node& node = nodes[n];
+		if (node.count > 0) {
+			node.low = lows[items[node.first]];
+			node.high = highs[items[node.first]];
+			for (GLint i = node.first + 1; i < node.first + node.count; i++) {
+				node.low = glm::min(node.low, lows[items[i]]);
+				node.high = glm::max(node.high, highs[items[i]]);
+			}
+		}
+		else {
+			const Node& left = nodes[n + 1];
+			const Node& right = nodes[node.first];
+			node.low = glm::min(left.low, right.low);
+			node.high = glm::max(right.high, left.high);
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "physics.h"
+
+#include <algorithm>
+
+/*
+* Bounding volume hierarchy over a set of axis aligned boxes (usually the
+* triangles of a mesh). Built once top down by splitting at the median
+* along the widest axis; when the boxes move but stay the same boxes, as
+* for an animated mesh, Refit only recomputes the node bounds.
+*
+* Nodes are stored depth first, so a node's left child directly follows
+* it and every child comes after its parent.
+*/
+class Bvh
+{
+public:
+	struct Node {
+		glm::vec3 low, high;
+		GLint first;	// leaf: first entry in items; inner: right child
+		GLint count;	// leaf: number of items; inner: 0
+	};
+
+	std::vector<Node> nodes;
+	std::vector<GLint> items;	// box indices, grouped by leaf
+
+	void Build(const std::vector<glm::vec3>& lows, const std::vector<glm::vec3>& highs);
+	void Refit(const std::vector<glm::vec3>& lows, const std::vector<glm::vec3>& highs);
+
+	/*
+	* Calls visit(index) for every box whose leaf overlaps [low, high].
+	* Leaves hold a few boxes each, so callers still test the box itself.
+	*/
+	template <typename Visitor>
+	void Query(const glm::vec3& low, const glm::vec3& high, Visitor visit) const {
+		if (nodes.empty()) return;
+
+		GLint stack[maxDepth];
+		GLint depth = 0;
+		stack[depth++] = 0;
+		while (depth > 0) {
+			GLint n = stack[--depth];
+			const Node& node = nodes[n];
+			if (node.low.x > high.x || node.low.y > high.y || node.low.z > high.z ||
+				node.high.x < low.x || node.high.y < low.y || node.high.z < low.z) continue;
+
+			if (node.count > 0) {
+				for (GLint i = node.first; i < node.first + node.count; i++) visit(items[i]);
+			}
+			else {
+				stack[depth++] = node.first;
+				stack[depth++] = n + 1;
+			}
+		}
+	}
+
+private:
+	// median splits keep the tree balanced, so this covers any mesh that
+	// fits in memory
+	static const GLint maxDepth = 64;
+
+	GLint BuildNode(const std::vector<glm::vec3>& lows, const std::vector<glm::vec3>& highs,
+		GLint first, GLint count);
+};
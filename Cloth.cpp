@@ -1,9 +1,16 @@
 #include "Cloth.h"
 
 #include "Window.h"
+#include "Profiler.h"
+#include "Scene.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 
 /*
-* Constructor for a piece of fabric. 
+* Constructor for a piece of fabric. Builds the simulation, then the GL
+* buffers and tweak bar entries for it.
 * Make sure particlesL/W is > 1 and odd
 * 
 * clothLength: desired length for fabric in OpenGL units (we use as 1 m)
@@ -13,198 +20,71 @@
 * topLeftPos: top left position of cloth
 * clothMass: default mass of this whole cloth
 * randomness: randomness factor for each particle's position
+* integrator: how to step the cloth forward (can be changed later)
+* vertexFormat: how vertices are sent to the GPU
 */
 Cloth::Cloth(GLfloat clothLength, GLfloat clothWidth, GLint particlesL, 
 	GLint particlesW, glm::vec3 topLeftPos, GLfloat clothMass, 
-	GLfloat randomness) : clothLength(clothLength), clothWidth(clothWidth),
-	topLeftPos(topLeftPos) {
-	// make sure inputs are useful
-
-	
-	/* initialize particles ======================================*/
-
-	// calculate mass for each particle
-	this->totalParticles = particlesL * particlesW;
-	this->particleMass = clothMass / (this->totalParticles);
-	this->particlesW = particlesW;
-
-	// get spacing of particles
-	GLfloat spacingL = clothLength / particlesL;
-	GLfloat spacingW = clothWidth / particlesW;
-
-	// index to keep track of each particle
-	GLint currIndex = 0;
-
-	// for each particle row
-	for (unsigned int row = 0; row < particlesL; row++) {
-		// move position downwards each row by spacing
-		glm::vec3 downDirection = glm::vec3(0.0f, -1.0f, 0.0f);
-		glm::vec3 rowPos = topLeftPos + (row * spacingL * downDirection);
-
-		// for each particle column
-		for (unsigned int column = 0; column < particlesW; column++) {
-			// move position to right each row by spacing
-			glm::vec3 rightDirection = glm::vec3(1.0f, 0.0f, 0.01f);
-			glm::vec3 currPosition = rowPos + (column * spacingW * rightDirection);
-
-			// TODO: randomize position from input factor
-			
-			// create new particle at position
-			Particle* currParticle = new Particle(currIndex, currPosition, particleMass);
-			currIndex++;
-			
-			// push it
-			particles.push_back(currParticle);
-
-			// fixate if it's the first row of particles
-			if (row == 0) {
-				currParticle->Fixate();
-			}
-		}
-	}
-
-	//TwAddVarRW(Window::bar, "Cloth Top", TW_TYPE_DIR3F, &topRowPos, "Cloth Top");
-
-	// reset index counter
-	currIndex = 0;
-
-	/* initialize springdampers between them =====================*/
-
-	// for every row
-	for (unsigned int row = 0; row < particlesL; row ++) {
-
-		// for every column
-		for (unsigned int column = 0; column < particlesW; column ++) {
-			// get particle at this index
-			GLint entry = row * particlesW + column;
-			Particle* currParticle = particles[entry];
-
-			// get bottom/right/bottom-right/top-right particles if in range
-			Particle* botP = (entry + particlesW) < totalParticles ? 
-				particles[entry + particlesW] : nullptr;
-			Particle* rightP = (entry + 1) < totalParticles ?
-				particles[entry + 1] : nullptr;
-			Particle* botRightP = (entry + particlesW + 1 < totalParticles) ?
-				particles[entry + particlesW + 1] : nullptr;
-			Particle* topRightP = (entry - particlesW + 1) >= 0 ?
-				particles[entry - particlesW + 1] : nullptr;
-
-			GLfloat springConst = 1.0001f;
-			GLfloat dampingConst = 0.50001f;
-			//GLfloat restLength = spacingL;
-
-			// create spring-dampers for existing particles
-			if (botP) {
-				GLfloat dist = glm::distance(currParticle->getPosition(), botP->getPosition());
-				SpringDamper* currSD = new SpringDamper(currIndex, springConst, dampingConst,
-					dist, currParticle, botP);
-
-				springDampers.push_back(currSD);
-
-				currIndex++;
-			}
-			if (botRightP) {
-				GLfloat dist = glm::distance(currParticle->getPosition(), botRightP->getPosition());
-				SpringDamper* currSD = new SpringDamper(currIndex, springConst, dampingConst,
-					dist, currParticle, botRightP);
-
-				springDampers.push_back(currSD);
-
-				currIndex++;
-			}
-			if (rightP) {
-				GLfloat dist = glm::distance(currParticle->getPosition(), rightP->getPosition());
-				SpringDamper* currSD = new SpringDamper(currIndex, springConst, dampingConst,
-					dist, currParticle, rightP);
-
-				springDampers.push_back(currSD);
-
-				currIndex++;
-			}
-			if (topRightP) {
-				GLfloat dist = glm::distance(currParticle->getPosition(), topRightP->getPosition());
-				SpringDamper* currSD = new SpringDamper(currIndex, springConst, dampingConst,
-					dist, currParticle, topRightP);
-
-				springDampers.push_back(currSD);
-
-				currIndex++;
-			}
-		}
-	}
-
-	// reset currIndex
-	currIndex = 0;
-
-	/* initialize more spring-dampers for bending force ===========*/
-
-	/* initialize triangles from particles =======================*/
-
-	this->airVelocity = glm::vec3(0.0f);
-	TwAddVarRW(Window::bar, "Wind Speed", TW_TYPE_DIR3F, &airVelocity, "Wind Speed");
-
-	// for every row except last
-	for (unsigned int row = 0; row < particlesL - 1; row++) {
-		//for every column except last
-		for (unsigned int column = 0; column < particlesW - 1; column++) {
-			// get particles at this index
-			GLint entry = row * particlesW + column;
-			Particle* currP = particles[entry];
+	GLfloat randomness, Integrator integrator, VertexFormat vertexFormat) : 
+	vertexFormat(vertexFormat), simulation(clothLength, clothWidth, particlesL, 
+	particlesW, topLeftPos, clothMass, randomness, integrator), 
+	simulationThread(simulation) {
+	this->Initialize();
+}
 
-			// get surrounding particles for two triangles connected to currP
-			Particle* botP = particles[entry + particlesW];
-			Particle* botRightP = particles[entry + particlesW + 1];
-			Particle* rightP = particles[entry + 1];
+/*
+* Constructor for every cloth a scene describes, simulated together and
+* drawn with one draw call.
+* 
+* scene: loaded scene to build
+* vertexFormat: how vertices are sent to the GPU
+*/
+Cloth::Cloth(const Scene& scene, VertexFormat vertexFormat) : 
+	vertexFormat(vertexFormat), simulationThread(simulation) {
+	scene.Build(simulation);
+	this->Initialize();
+}
 
-			// CONSTANTS
-			GLfloat fluid = 1.225f;
-			GLfloat drag = 1.2f;
-			glm::vec3* airV = &this->airVelocity; //glm::vec3(0.9f, 0.0f, 1.2f);
+/*
+* Adds the tweak bar entries and creates the GL buffers, once simulation
+* holds all its cloths.
+*/
+void Cloth::Initialize() {
+	/* tweakable simulation settings =============================*/
 
-			// create first triangle and push it
-			Triangle* botTriang = new Triangle(currIndex, fluid, drag,
-				airV, currP, botP, botRightP);
-			triangles.push_back(botTriang);
+	// the bar edits a copy, the simulation may be stepping on its own
+	// thread (see ApplySettings)
+	settings.Read(simulation);
+	appliedSettings = settings;
+	this->lastSubsteps = simulation.lastSubsteps;
+	this->lastContacts = simulation.selfCollision.lastContacts;
 
-			//indices.push_back(currIndex);
-			indices.push_back(botTriang->P1->index);
-			indices.push_back(botTriang->P2->index);
-			indices.push_back(botTriang->P3->index);
+	//TwAddVarRW(Window::bar, "Cloth Top", TW_TYPE_DIR3F, &topRowPos, "Cloth Top");
+	TwAddVarRW(Window::bar, "Wind Speed", TW_TYPE_DIR3F, &settings.airVelocity, "Wind Speed");
 
-			currIndex++;
+	TwType forceModeType = TwDefineEnumFromString("ForceMode", "Serial,Colored,Gather");
+	TwAddVarRW(Window::bar, "Force Mode", forceModeType, &settings.forceMode, "");
 
-			// create second triangle and push it
-			Triangle* rightTriang = new Triangle(currIndex, fluid, drag,
-				airV, currP, botRightP, rightP);
-			triangles.push_back(rightTriang);
+	TwType integratorType = TwDefineEnumFromString("Integrator", "Explicit,Implicit,XPBD");
+	TwAddVarRW(Window::bar, "Integrator", integratorType, &settings.integrator, "");
+	TwAddVarRW(Window::bar, "Implicit Steps", TW_TYPE_INT32, &settings.implicitSubsteps, "min=1 max=100");
+	TwAddVarRW(Window::bar, "XPBD Steps", TW_TYPE_INT32, &settings.xpbdSubsteps, "min=1 max=100");
+	TwAddVarRW(Window::bar, "XPBD Iterations", TW_TYPE_INT32, &settings.xpbdIterations, "min=1 max=100");
 
-			//indices.push_back(currIndex);
-			indices.push_back(rightTriang->P1->index);
-			indices.push_back(rightTriang->P2->index);
-			indices.push_back(rightTriang->P3->index);
+	TwAddVarRW(Window::bar, "Safety Factor", TW_TYPE_FLOAT, &settings.safetyFactor, "min=0.05 max=1 step=0.05");
+	TwAddVarRO(Window::bar, "Substeps", TW_TYPE_INT32, &lastSubsteps, "");
 
-			currIndex++;
-		}
-	}
+	TwAddVarRW(Window::bar, "Self Collision", TW_TYPE_BOOLCPP, &settings.selfCollision, "");
+	TwAddVarRW(Window::bar, "Thickness", TW_TYPE_FLOAT, &settings.thickness, "min=0.001 max=1 step=0.005");
+	TwAddVarRO(Window::bar, "Contacts", TW_TYPE_INT32, &lastContacts, "");
 
-	// reset currIndex
-	currIndex = 0;
+	TwAddVarRW(Window::bar, "Restitution", TW_TYPE_FLOAT, &settings.restitution, "min=0 max=1 step=0.05");
+	TwAddVarRW(Window::bar, "Friction", TW_TYPE_FLOAT, &settings.friction, "min=0 max=2 step=0.05");
 	
 	/* initialize OpenGL/glsm stuff ======================================*/
 
-	for (Particle* p : particles) { p->resetNormal(); }
-	for (Triangle* t : triangles) { t->computeNormal(); }
-
-	for (Particle* p : particles) {
-		p->normalizeNormal();
-
-		positions.push_back(p->getPosition());
-		normals.push_back(p->getNormal());
-
-		//std::cout << p->getPosition().x << ", " << p->getPosition().y << ", " << p->getPosition().z << ", " << std::endl;
-	}
-
-	//std::cout << "Sweeped" << std::endl;
+	GLint numParticles = simulation.particles.size();
+	const std::vector<unsigned int>& indices = simulation.indices;
 
 	// Model matrix.
 	this->model = glm::mat4(1.0f);
@@ -212,157 +92,300 @@ Cloth::Cloth(GLfloat clothLength, GLfloat clothWidth, GLint particlesL,
 	// The color of the cloth.
 	this->color = glm::vec3(0.0f, 1.0f, 1.0f);
 
-	// Generate a vertex array (VAO) and two vertex buffer objects (VBO).
+	// Generate a vertex array (VAO).
 	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO_positions);
-	glGenBuffers(1, &VBO_normals);
 
 	// Bind to the VAO.
 	glBindVertexArray(VAO);
 
-	// Bind to the first VBO - We will use it to store the vertices
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_positions);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * positions.size(), positions.data(), GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
-
-	// Bind to the second VBO - We will use it to store the normals
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_normals);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * normals.size(), normals.data(), GL_STATIC_DRAW);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
+	// Streaming buffers for the vertices. Every region holds all particles,
+	// so which region a frame went into is picked with the base vertex
+	if (vertexFormat == VERTEX_PACKED) {
+		// snorm16 position relative to the bounds, snorm 10_10_10_2 normal
+		vertexBuffer.Create(sizeof(PackedVertex) * numParticles);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(PackedVertex), 
+			(void*)offsetof(PackedVertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), 
+			(void*)offsetof(PackedVertex, normal));
+	}
+	else {
+		positionBuffer.Create(sizeof(glm::vec3) * numParticles);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
+
+		// Streaming buffer for the normals
+		normalBuffer.Create(sizeof(glm::vec3) * numParticles);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
+	}
 
-	// Generate EBO, bind the EBO to the bound VAO and send the data
+	// Generate EBO, bind the EBO to the bound VAO and send the data. The
+	// base vertex is added after the fetch, so 16-bit indices only need
+	// to cover one region
 	glGenBuffers(1, &EBO);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), indices.data(), GL_STATIC_DRAW);
+	if (numParticles <= 65536) {
+		std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned short) * shortIndices.size(), shortIndices.data(), GL_STATIC_DRAW);
+		this->indexType = GL_UNSIGNED_SHORT;
+	}
+	else {
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), indices.data(), GL_STATIC_DRAW);
+		this->indexType = GL_UNSIGNED_INT;
+	}
 
 	// Unbind the VBOs.
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
+	this->playbackTime = 0.0f;
+
 }
 
 Cloth::~Cloth() {
-	for(Particle * p : particles) {
-		delete p;
-	}
+	// the simulation thread has to let go of the simulation first
+	simulationThread.Stop();
 
-	for (SpringDamper* sd : springDampers) {
-		delete sd;
-	}
-
-	for (Triangle* t : triangles) {
-		delete t;
-	}
-
-	// Delete the VBOs and the VAO.
-	glDeleteBuffers(1, &VBO_positions);
-	glDeleteBuffers(1, &VBO_normals);
+	// Delete the EBO and the VAO (the streaming buffers clean up after themselves).
 	glDeleteBuffers(1, &EBO);
 	glDeleteVertexArrays(1, &VAO);
 }
 
 void Cloth::Update() {
-	//std::cout << "Updating" << std::endl;
-
 	//model = glm::rotate(glm::radians(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
-	// Apply oversampling (sample 10 times per frame to stabilize simulation)
-	GLfloat timeStep = 1.0f / 40.0f;	// Adjust
-	GLfloat oversampleFactor = 0100.0f;	// Adjust
-	GLfloat newDeltaTime = timeStep / oversampleFactor;
-
-	
+	simulation.Update();
+}
 
-	for (unsigned int i = 0; i < oversampleFactor; i++) {
-		this->ComputeForce(newDeltaTime);
-		// Integrate Motion 
-		for (Particle* p : particles) {
-			// Compute forces and apply them
-			
-			p->Integrate(newDeltaTime);
-		}
+/*
+* Simulates as many fixed frame steps as fit into the wall-clock time
+* that passed, keeping the leftover for next time.
+* 
+* elapsedTime: seconds since the last call
+*/
+void Cloth::Advance(GLfloat elapsedTime) {
+	this->ApplySettings();
+
+	if (isPlaying()) {
+		// loop, without letting the clock lose precision
+		GLfloat duration = cache.getNumFrames() * cache.getFrameTime();
+		playbackTime = std::fmod(playbackTime + elapsedTime, duration);
+		return;
 	}
 
-	for (Particle* p : particles) { p->resetNormal(); }
-	for (Triangle* t : triangles) { t->computeNormal(); }
+	// the simulation thread keeps its own time
+	if (simulationThread.isRunning()) return;
+
+	simulation.Advance(elapsedTime);
+	this->lastSubsteps = simulation.lastSubsteps;
+	this->lastContacts = simulation.selfCollision.lastContacts;
+}
 
-	unsigned int currIndex = 0;
-	for (Particle* p : particles) { 
-		p->normalizeNormal();
+/*
+* Hands whatever was changed on the tweak bar since last time to the
+* simulation, between two frame steps if it runs on its own thread.
+*/
+void Cloth::ApplySettings() {
+	if (settings == appliedSettings) return;
+	this->appliedSettings = settings;
 
-		positions[currIndex] = p->getPosition();
-		normals[currIndex] = p->getNormal();
+	Settings changed = settings;
+	std::function<void(ClothSimulation&)> apply = [changed](ClothSimulation& simulation) {
+		changed.Apply(simulation);
+	};
 
-		//std::cout << p->getPosition().x << ", " << p->getPosition().y << ", " << p->getPosition().z << ", " << std::endl;
+	if (simulationThread.isRunning()) simulationThread.Post(apply);
+	else apply(simulation);
+}
 
-		currIndex++;
+void Cloth::Settings::Read(const ClothSimulation& simulation) {
+	this->airVelocity = simulation.airVelocity;
+	this->forceMode = simulation.forceMode;
+	this->integrator = simulation.integrator;
+	this->implicitSubsteps = simulation.implicitSubsteps;
+	this->xpbdSubsteps = simulation.xpbdSubsteps;
+	this->xpbdIterations = simulation.xpbdSolver.iterations;
+	this->safetyFactor = simulation.scheduler.safetyFactor;
+	this->selfCollision = simulation.selfCollision.enabled;
+	this->thickness = simulation.selfCollision.thickness;
+	this->restitution = simulation.colliders.restitution;
+	this->friction = simulation.colliders.friction;
+}
+
+void Cloth::Settings::Apply(ClothSimulation& simulation) const {
+	simulation.airVelocity = airVelocity;
+	simulation.forceMode = forceMode;
+	simulation.integrator = integrator;
+	simulation.implicitSubsteps = implicitSubsteps;
+	simulation.xpbdSubsteps = xpbdSubsteps;
+	simulation.xpbdSolver.iterations = xpbdIterations;
+	simulation.scheduler.safetyFactor = safetyFactor;
+	simulation.selfCollision.enabled = selfCollision;
+	simulation.selfCollision.thickness = thickness;
+	simulation.colliders.restitution = restitution;
+	simulation.colliders.friction = friction;
+}
+
+bool Cloth::Settings::operator==(const Settings& other) const {
+	return airVelocity == other.airVelocity && forceMode == other.forceMode &&
+		integrator == other.integrator && implicitSubsteps == other.implicitSubsteps &&
+		xpbdSubsteps == other.xpbdSubsteps && xpbdIterations == other.xpbdIterations &&
+		safetyFactor == other.safetyFactor && selfCollision == other.selfCollision &&
+		thickness == other.thickness && restitution == other.restitution &&
+		friction == other.friction;
+}
+
+/*
+* Moves the simulation to its own thread, or back onto the caller's
+* (Advance then steps it again).
+* 
+* threaded: whether the simulation should run in the background
+*/
+void Cloth::SetThreaded(bool threaded) {
+	if (threaded) simulationThread.Start();
+	else simulationThread.Stop();
+}
+
+/*
+* Draws a baked vertex cache (see VertexCacheWriter) from now on instead
+* of the simulation, looping it. Only works with VERTEX_PACKED, which the
+* cache decodes straight into.
+* 
+* path: cache file baked from a cloth with as many particles as this one
+* returns: false if it can't be played, the simulation is drawn then
+*/
+bool Cloth::Play(const std::string& path) {
+	this->StopPlaying();
+	if (vertexFormat != VERTEX_PACKED || !cache.Open(path)) return false;
+
+	if (cache.getNumVertices() != simulation.particles.size()) {
+		cache.Close();
+		return false;
 	}
+	this->playbackTime = 0.0f;
+	return true;
+}
 
-	//std::cout << "Sweeped" << std::endl;
+void Cloth::StopPlaying() {
+	cache.Close();
 }
 
-	
+/*
+* Moves the fixed particles of every cloth, passing the move on to the
+* simulation thread if it is running.
+* 
+* distToMove: distance to move each of them
+*/
+void Cloth::MoveFixedParticles(glm::vec3 distToMove) {
+	std::function<void(ClothSimulation&)> move = [distToMove](ClothSimulation& simulation) {
+		ParticleSystem& particles = simulation.particles;
+		for (GLint i = 0; i < particles.size(); i++) {
+			if (particles.pinned[i]) particles.updateFixedPos(i, distToMove);
+		}
+	};
+
+	if (simulationThread.isRunning()) simulationThread.Post(move);
+	else move(simulation);
+}
+
+void Cloth::Draw(const glm::mat4& viewProjMtx, GLuint shader, const ShaderUniforms& uniforms) {
+	const std::vector<glm::vec3>* positionSource = &simulation.particles.positions;
+	const std::vector<glm::vec3>* normalSource = &simulation.particles.normals;
+
+	// the simulation thread owns its arrays, so draw its latest snapshot,
+	// blended from the state before it for smooth motion
+	if (simulationThread.isRunning() && !isPlaying()) {
+		const SimulationThread::Snapshot& snapshot = simulationThread.Acquire();
+		this->lastSubsteps = snapshot.substeps;
+		this->lastContacts = snapshot.contacts;
+		GLfloat alpha = simulationThread.getAlpha(snapshot, SimulationThread::Now());
+
+		interpolated.resize(snapshot.positions.size());
+		for (size_t i = 0; i < interpolated.size(); i++) {
+			interpolated[i] = glm::mix(snapshot.previousPositions[i], snapshot.positions[i], alpha);
+		}
+
+		positionSource = &interpolated;
+		normalSource = &snapshot.normals;
+	}
+
+	const std::vector<glm::vec3>& positions = *positionSource;
+	const std::vector<glm::vec3>& normals = *normalSource;
+
+	// copy straight out of the simulation's arrays into GPU visible memory
+	glm::vec3 positionOffset(0.0f), positionScale(1.0f);
+	GLint region;
+	{
+		ProfileScope scope(PHASE_UPLOAD);
+
+		if (isPlaying()) {
+			// decoded from the mapped file into the mapped buffer
+			GLint frame = (GLint)(playbackTime / cache.getFrameTime()) % cache.getNumFrames();
+			cache.Decode(frame, (PackedVertex*)vertexBuffer.Map(), positionOffset, positionScale);
+			vertexBuffer.Unmap();
+			region = vertexBuffer.getRegion();
+		}
+		else if (vertexFormat == VERTEX_PACKED) {
+			PackedVertex::ComputeBounds(positions, positionOffset, positionScale);
+			PackedVertex::Pack(positions, normals, positionOffset, positionScale, 
+				(PackedVertex*)vertexBuffer.Map());
+			vertexBuffer.Unmap();
+			region = vertexBuffer.getRegion();
+		}
+		else {
+			size_t streamSize = sizeof(glm::vec3) * positions.size();
+			memcpy(positionBuffer.Map(), positions.data(), streamSize);
+			positionBuffer.Unmap();
+
+			memcpy(normalBuffer.Map(), normals.data(), streamSize);
+			normalBuffer.Unmap();
+			region = positionBuffer.getRegion();
+		}
+	}
 
-void Cloth::Draw(const glm::mat4& viewProjMtx, GLuint shader) {
 	// actiavte the shader program 
 	glUseProgram(shader);
 
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-	// get the locations and send the uniforms to the shader 
-	glUniformMatrix4fv(glGetUniformLocation(shader, "viewProj"), 1, false, (float*)&viewProjMtx);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, (float*)&model);
-	glUniform3fv(glGetUniformLocation(shader, "DiffuseColor"), 1, &color[0]);
+	// send the uniforms to the shader, at the locations looked up at load
+	glUniformMatrix4fv(uniforms.viewProj, 1, false, (float*)&viewProjMtx);
+	glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, (float*)&model);
+	glUniform3fv(uniforms.diffuseColor, 1, &color[0]);
+	glUniform3fv(uniforms.positionOffset, 1, &positionOffset[0]);
+	glUniform3fv(uniforms.positionScale, 1, &positionScale[0]);
 
 	// Bind the VAO
 	glBindVertexArray(VAO);
 
-	// Bind to the first VBO - We will use it to store the vertices
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_positions);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * positions.size(), positions.data(), GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
-
-	// Bind to the second VBO - We will use it to store the normals
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_normals);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * normals.size(), normals.data(), GL_STATIC_DRAW);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
+	// draw the points using triangles, indexed with the EBO, from the
+	// region this frame was written to; every cloth of the simulation
+	// shares the region and the EBO, so one call draws them all
+	{
+		ProfileScope scope(PHASE_DRAW);
+		GLint baseVertex = region * (GLint)positions.size();
+		glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)simulation.indices.size(), 
+			indexType, 0, baseVertex);
+		//glDrawArrays(GL_TRIANGLES, 0, positions.size());
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	// the GPU owns this frame's regions until the draw is done
+	if (vertexFormat == VERTEX_PACKED) {
+		vertexBuffer.Fence();
+	}
+	else {
+		positionBuffer.Fence();
+		normalBuffer.Fence();
+	}
 
-	// draw the points using triangles, indexed with the EBO
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-	//glDrawArrays(GL_TRIANGLES, 0, positions.size());
+	// other meshes share the shader and send plain positions
+	glm::vec3 identityOffset(0.0f), identityScale(1.0f);
+	glUniform3fv(uniforms.positionOffset, 1, &identityOffset[0]);
+	glUniform3fv(uniforms.positionScale, 1, &identityScale[0]);
 
 	// Unbind the VAO and shader program
 	glBindVertexArray(0);
 	glUseProgram(0);
 }
-
-/*
-* Takes care of computing all forces (gravity, spring-dampers, bending, 
-* aerodynamic drag) to each particle.
-* 
-* deltaTime: the size of the time step to take when integrating motion
-*/
-void Cloth::ComputeForce(GLfloat deltaTime) {
-	// Apply gravity to each particle
-	for (Particle* p : particles) {
-		// remember our units are 1 unit = 1 m. So 9.8 m for g
-		glm::vec3 gravityForce = p->mass * glm::vec3(0.0f, -09.8f, 0.0f);
-		p->ApplyForce(gravityForce);
-	}
-
-	// apply each spring-damper's force
-	for (SpringDamper* sd : springDampers) {
-		sd->ComputeForce();
-	}
-
-	// apply each aerodynamic force
-	for (Triangle* t : triangles) {
-		t->ComputeForce();
-	}
-}
\ No newline at end of file
@@ -1,56 +1,98 @@
 #pragma once
 
-#include "SpringDamper.h"
-#include "Triangle.h"
+#include "core.h"
+#include "ClothSimulation.h"
+#include "PackedVertex.h"
+#include "SimulationThread.h"
+#include "StreamingBuffer.h"
+#include "VertexCache.h"
+#include "shader.h"
 
 // forward declare
 class Window;
+class Scene;
 
+// how Cloth lays out the vertices it streams to the GPU
+enum VertexFormat {
+	VERTEX_FLOAT,	// separate float3 position and float3 normal buffers
+	VERTEX_PACKED	// one interleaved buffer of PackedVertex (half the size)
+};
+
+/*
+* Drawable fabric, one piece or every cloth of a scene. All the physics
+* lives in the wrapped ClothSimulation; this only owns the GL buffers and
+* tweak bar entries, shared by all its cloths so they upload and draw
+* together.
+*/
 class Cloth
 {
 private:
-	// VAO/VBOs/EBO
+	// VAO/VBOs/EBO, positions and normals are rewritten every frame
 	GLuint VAO;
-	GLuint VBO_positions, VBO_normals, EBO;
+	VertexFormat vertexFormat;
+	StreamingBuffer positionBuffer, normalBuffer;	// VERTEX_FLOAT
+	StreamingBuffer vertexBuffer;					// VERTEX_PACKED
+	GLuint EBO;
+	GLenum indexType;	// 16-bit indices whenever every particle fits
 
 	glm::mat4 model;
 	glm::vec3 color;
 
-	// information vectors for VBOs and EBO
-	std::vector<glm::vec3> positions;
-	std::vector<glm::vec3> normals;
-	std::vector<unsigned int> indices;
+	// positions blended between the simulation thread's last two states
+	std::vector<glm::vec3> interpolated;
+
+	// baked animation drawn instead of the simulation while open
+	VertexCache cache;
+	GLfloat playbackTime;
 
-	// lists of actual particles' data
-	
-	std::vector<SpringDamper*> springDampers;
-	std::vector<SpringDamper*> bendingForces;
-	std::vector<Triangle*> triangles;
+	// copy of the simulation's tweakable settings the tweak bar edits,
+	// handed to the simulation between frame steps when it changes
+	struct Settings {
+		glm::vec3 airVelocity;
+		ForceMode forceMode;
+		Integrator integrator;
+		GLint implicitSubsteps, xpbdSubsteps, xpbdIterations;
+		GLfloat safetyFactor;
+		bool selfCollision;
+		GLfloat thickness;
+		GLfloat restitution, friction;
 
-	// cloth logistic general data
-	GLfloat clothLength, clothWidth;
-	glm::vec3 topLeftPos;
-	GLfloat particleMass;
-	GLfloat totalParticles;
-	
+		void Read(const ClothSimulation& simulation);
+		void Apply(ClothSimulation& simulation) const;
+		bool operator==(const Settings& other) const;
+	};
+	Settings settings, appliedSettings;
+
+	// statistics of the last frame step, shown on the tweak bar
+	GLint lastSubsteps, lastContacts;
+
+	void Initialize();
+	void ApplySettings();
 
 public:
-	std::vector<Particle*> particles;
+	ClothSimulation simulation;
 	glm::vec3 topRowPos;
-	GLfloat particlesW;
 
-	glm::vec3 airVelocity;
+	// steps simulation in the background once started (see SetThreaded)
+	SimulationThread simulationThread;
 
 	// constructor for a piece of fabric
 	Cloth(GLfloat clothLength, GLfloat clothWidth, GLint particlesL,
 		GLint particlesW, glm::vec3 topLeftPos, GLfloat clothMass,
-		GLfloat randomness);
+		GLfloat randomness, Integrator integrator = INTEGRATOR_EXPLICIT,
+		VertexFormat vertexFormat = VERTEX_PACKED);
+	// constructor for all the cloths of a scene
+	Cloth(const Scene& scene, VertexFormat vertexFormat = VERTEX_PACKED);
 	// TODO: create more constructors if we want to do rope/etc
 	~Cloth();
 
 	void Update();
-	void Draw(const glm::mat4& viewProjMtx, GLuint shader);
+	void Advance(GLfloat elapsedTime);
+	void Draw(const glm::mat4& viewProjMtx, GLuint shader, const ShaderUniforms& uniforms);
 
-	void ComputeForce(GLfloat deltaTime);
+	void SetThreaded(bool threaded);
+	bool Play(const std::string& path);
+	void StopPlaying();
+	bool isPlaying() const { return cache.isOpen(); }
+	void MoveFixedParticles(glm::vec3 distToMove);
 };
-
@@ -0,0 +1,591 @@
+#include "ClothSimulation.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+
+// smallest number of loop iterations worth handing to another thread
+static const GLint parallelGrain = 512;
+
+// a quarter of the stretch springs' stiffness keeps folds soft but lets
+// coarse cloths drape instead of crumpling
+const GLfloat ClothSimulation::defaultBending = 0.25f;
+
+/*
+* Constructor for a simulation with no cloth in it yet; add them with
+* AddCloth, then call BuildTables before stepping.
+* 
+* integrator: how to step the cloths forward (can be changed later)
+*/
+ClothSimulation::ClothSimulation(Integrator integrator) : integrator(integrator) {
+	this->airVelocity = glm::vec3(0.0f);
+
+	this->forceMode = FORCE_COLORED;
+	this->implicitSubsteps = 2;
+	this->xpbdSubsteps = 10;
+	this->lastSubsteps = 0;
+
+	colliders.AddPlane(glm::vec3(0.0f, -4.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+/*
+* Constructor for a piece of fabric. 
+* Make sure particlesL/W is > 1 and odd
+* 
+* clothLength: desired length for fabric in OpenGL units (we use as 1 m)
+* clothWidth: desired width for fabric in OpenGL units
+* particlesL: desired number of particles across length
+* particlesW: desired number of particles across width
+* topLeftPos: top left position of cloth
+* clothMass: default mass of this whole cloth
+* randomness: randomness factor for each particle's position
+* integrator: how to step the cloth forward (can be changed later)
+*/
+ClothSimulation::ClothSimulation(GLfloat clothLength, GLfloat clothWidth, GLint particlesL, 
+	GLint particlesW, glm::vec3 topLeftPos, GLfloat clothMass, 
+	GLfloat randomness, Integrator integrator) : ClothSimulation(integrator) {
+	this->AddCloth(clothLength, clothWidth, particlesL, particlesW, topLeftPos, clothMass, randomness);
+	this->BuildTables();
+}
+
+/*
+* Adds a piece of fabric, its first row pinned, behind the particles,
+* spring-dampers and triangles already there. Call BuildTables once all
+* cloths are added.
+* Make sure particlesL/W is > 1 and odd
+* 
+* (other arguments as for the constructor)
+* bending: spring constant of the springs resisting folds, 0 for none
+* returns: index of the new cloth in getCloths()
+*/
+GLint ClothSimulation::AddCloth(GLfloat clothLength, GLfloat clothWidth, GLint particlesL, 
+	GLint particlesW, glm::vec3 topLeftPos, GLfloat clothMass, GLfloat randomness,
+	GLfloat bending) {
+	ClothLayout cloth;
+	cloth.length = clothLength;
+	cloth.width = clothWidth;
+	cloth.particlesL = particlesL;
+	cloth.particlesW = particlesW;
+	cloth.topLeftPos = topLeftPos;
+	cloth.mass = clothMass;
+	cloth.bending = bending;
+	cloth.firstParticle = particles.size();
+	cloth.firstIndex = (GLint)indices.size();
+
+	/* initialize particles ======================================*/
+
+	// calculate mass for each particle
+	GLint totalParticles = particlesL * particlesW;
+	GLfloat particleMass = clothMass / totalParticles;
+
+	// get spacing of particles
+	GLfloat spacingL = clothLength / particlesL;
+	GLfloat spacingW = clothWidth / particlesW;
+
+	// for each particle row
+	for (unsigned int row = 0; row < particlesL; row++) {
+		// move position downwards each row by spacing
+		glm::vec3 downDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+		glm::vec3 rowPos = topLeftPos + (row * spacingL * downDirection);
+
+		// for each particle column
+		for (unsigned int column = 0; column < particlesW; column++) {
+			// move position to right each row by spacing
+			glm::vec3 rightDirection = glm::vec3(1.0f, 0.0f, 0.01f);
+			glm::vec3 currPosition = rowPos + (column * spacingW * rightDirection);
+
+			// TODO: randomize position from input factor
+			
+			// create new particle at position
+			GLint currParticle = particles.AddParticle(currPosition, particleMass);
+
+			// fixate if it's the first row of particles
+			if (row == 0) {
+				particles.Fixate(currParticle);
+			}
+		}
+	}
+
+	/* initialize springdampers between them =====================*/
+
+	// for every row
+	for (unsigned int row = 0; row < particlesL; row ++) {
+
+		// for every column
+		for (unsigned int column = 0; column < particlesW; column ++) {
+			// get particle at this index, within this cloth
+			GLint entry = row * particlesW + column;
+			GLint currParticle = cloth.firstParticle + entry;
+
+			// get bottom/right/bottom-right/top-right particles if in range
+			GLint botP = (entry + particlesW) < totalParticles ? 
+				entry + particlesW : -1;
+			GLint rightP = (entry + 1) < totalParticles ?
+				entry + 1 : -1;
+			GLint botRightP = (entry + particlesW + 1 < totalParticles) ?
+				entry + particlesW + 1 : -1;
+			GLint topRightP = (entry - particlesW + 1) >= 0 ?
+				entry - particlesW + 1 : -1;
+
+			GLfloat springConst = 1.0001f;
+			GLfloat dampingConst = 0.50001f;
+			//GLfloat restLength = spacingL;
+
+			// create spring-dampers for existing particles
+			GLint neighbours[4] = { botP, botRightP, rightP, topRightP };
+			for (GLint neighbour : neighbours) {
+				if (neighbour < 0) continue;
+				GLint otherParticle = cloth.firstParticle + neighbour;
+				GLfloat dist = glm::distance(particles.positions[currParticle], particles.positions[otherParticle]);
+				springDampers.push_back(SpringDamper(currParticle, otherParticle, dist, 
+					springConst, dampingConst));
+			}
+		}
+	}
+
+	/* initialize more spring-dampers for bending force ===========*/
+
+	// skip-one springs along the rows and columns resist folding at the
+	// particle they skip. They are plain entries of the spring table, so
+	// every integrator and force mode handles them with the others
+	if (bending > 0.0f) {
+		GLfloat bendingDamping = 0.5f * bending;
+
+		for (GLint row = 0; row < particlesL; row++) {
+			for (GLint column = 0; column < particlesW; column++) {
+				GLint currParticle = cloth.firstParticle + row * particlesW + column;
+
+				// two to the right, two below
+				GLint neighbours[2] = { 
+					column + 2 < particlesW ? currParticle + 2 : -1,
+					row + 2 < particlesL ? currParticle + 2 * particlesW : -1
+				};
+				for (GLint otherParticle : neighbours) {
+					if (otherParticle < 0) continue;
+					GLfloat dist = glm::distance(particles.positions[currParticle], particles.positions[otherParticle]);
+					springDampers.push_back(SpringDamper(currParticle, otherParticle, dist,
+						bending, bendingDamping));
+				}
+			}
+		}
+	}
+
+	/* initialize triangles from particles =======================*/
+
+	// for every row except last
+	for (unsigned int row = 0; row < particlesL - 1; row++) {
+		//for every column except last
+		for (unsigned int column = 0; column < particlesW - 1; column++) {
+			// get particles at this index
+			GLint entry = cloth.firstParticle + row * particlesW + column;
+			GLint currP = entry;
+
+			// get surrounding particles for two triangles connected to currP
+			GLint botP = entry + particlesW;
+			GLint botRightP = entry + particlesW + 1;
+			GLint rightP = entry + 1;
+
+			// CONSTANTS
+			GLfloat fluid = 1.225f;
+			GLfloat drag = 1.2f;
+			glm::vec3* airV = &this->airVelocity; //glm::vec3(0.9f, 0.0f, 1.2f);
+
+			// create first triangle and push it
+			Triangle* botTriang = new Triangle((GLint)triangles.size(), fluid, drag,
+				airV, &particles, currP, botP, botRightP);
+			triangles.push_back(botTriang);
+
+			//indices.push_back(currIndex);
+			indices.push_back(botTriang->P1);
+			indices.push_back(botTriang->P2);
+			indices.push_back(botTriang->P3);
+
+			// create second triangle and push it
+			Triangle* rightTriang = new Triangle((GLint)triangles.size(), fluid, drag,
+				airV, &particles, currP, botRightP, rightP);
+			triangles.push_back(rightTriang);
+
+			//indices.push_back(currIndex);
+			indices.push_back(rightTriang->P1);
+			indices.push_back(rightTriang->P2);
+			indices.push_back(rightTriang->P3);
+		}
+	}
+
+	cloth.numIndices = (GLint)indices.size() - cloth.firstIndex;
+	cloths.push_back(cloth);
+	return (GLint)cloths.size() - 1;
+}
+
+/*
+* Builds everything derived from the particles and constraint tables of
+* all cloths together: the color groups, the gather and SIMD tables, the
+* stable step and the self-collision rest shape. Call after adding cloths
+* or changing which particles are pinned, while the simulation isn't
+* stepping.
+*/
+void ClothSimulation::BuildTables() {
+	// order the table by particle index for locality, then split it into
+	// groups that can be applied in parallel
+	SpringDamper::SortTable(springDampers);
+	SpringDamper::ColorTable(springDampers, particles.size(), springColors);
+
+	// split triangles into groups that can be applied in parallel
+	Triangle::ColorTriangles(triangles, particles.size(), triangleColors);
+
+	// incident constraint lists for gathering forces per particle
+	springAdjacency.BuildFromSprings(springDampers, particles.size());
+	triangleAdjacency.BuildFromTriangles(triangles, particles.size());
+	springKernel.Build(springDampers);
+	triangleKernel.Build(triangles);
+
+	// pick the explicit substep count from how stiff the springs are
+	scheduler.EstimateLimits(particles, springDampers);
+
+	// self collisions are sized to the particle spacing
+	GLfloat minRestLength = springDampers.empty() ? 0.0f : springDampers[0].restLength;
+	for (const SpringDamper& sd : springDampers) {
+		minRestLength = glm::min(minRestLength, sd.restLength);
+	}
+	std::vector<GLint> clothOf(particles.size());
+	for (GLint c = 0; c < (GLint)cloths.size(); c++) {
+		const ClothLayout& cloth = cloths[c];
+		std::fill(clothOf.begin() + cloth.firstParticle, 
+			clothOf.begin() + cloth.firstParticle + cloth.particlesL * cloth.particlesW, c);
+	}
+	selfCollision.Initialize(particles, clothOf, minRestLength);
+
+	this->ComputeNormals();
+}
+
+ClothSimulation::~ClothSimulation() {
+	for (Triangle* t : triangles) {
+		delete t;
+	}
+}
+
+void ClothSimulation::Update() {
+	//std::cout << "Updating" << std::endl;
+
+	// every call simulates one fixed frame step
+	GLfloat timeStep = scheduler.fixedTimeStep;
+
+	GLint numParticles = particles.size();
+
+	// implicit and XPBD steps are stable at any size, so take only a few
+	if (integrator == INTEGRATOR_IMPLICIT) {
+		GLfloat implicitDeltaTime = timeStep / implicitSubsteps;
+		for (GLint i = 0; i < implicitSubsteps; i++) {
+			if (!meshColliders.empty()) substepStart = particles.positions;
+			this->ComputeExternalForce();
+			ProfileScope scope(PHASE_SOLVE);
+			implicitSolver.Step(particles, springDampers, springAdjacency, implicitDeltaTime);
+			this->HandleCollisions();
+			this->HandleMeshCollisions(i, implicitSubsteps, implicitDeltaTime);
+			this->HandleSelfCollisions();
+		}
+		this->lastSubsteps = implicitSubsteps;
+	}
+	else if (integrator == INTEGRATOR_XPBD) {
+		GLfloat xpbdDeltaTime = timeStep / xpbdSubsteps;
+		for (GLint i = 0; i < xpbdSubsteps; i++) {
+			if (!meshColliders.empty()) substepStart = particles.positions;
+			this->ComputeExternalForce();
+			ProfileScope scope(PHASE_SOLVE);
+			xpbdSolver.Step(particles, springDampers, springColors, xpbdDeltaTime);
+			this->HandleCollisions();
+			this->HandleMeshCollisions(i, xpbdSubsteps, xpbdDeltaTime);
+			this->HandleSelfCollisions();
+		}
+		this->lastSubsteps = xpbdSubsteps;
+	}
+	else {
+		// Apply oversampling, as many substeps as the scheduler deems
+		// stable for the current stiffness and velocities
+		GLint oversampleFactor = scheduler.ComputeSubsteps(particles);
+		GLfloat newDeltaTime = timeStep / oversampleFactor;
+		this->lastSubsteps = oversampleFactor;
+
+		for (GLint i = 0; i < oversampleFactor; i++) {
+			if (!meshColliders.empty()) substepStart = particles.positions;
+			this->ComputeForce(newDeltaTime);
+
+			// Integrate Motion 
+			if (forceMode != FORCE_SERIAL) {
+				ProfileScope scope(PHASE_INTEGRATE);
+				ThreadPool::Shared().ParallelFor(numParticles, parallelGrain, 
+					[this, newDeltaTime](int begin, int end) {
+						for (GLint p = begin; p < end; p++) {
+							particles.Integrate(p, newDeltaTime);
+						}
+					});
+			}
+			else {
+				ProfileScope scope(PHASE_INTEGRATE);
+				for (GLint p = 0; p < numParticles; p++) {
+					particles.Integrate(p, newDeltaTime);
+				}
+			}
+
+			this->HandleCollisions();
+			this->HandleMeshCollisions(i, oversampleFactor, newDeltaTime);
+			this->HandleSelfCollisions();
+		}
+	}
+
+	for (MeshCollider* collider : meshColliders) {
+		collider->EndFrame();
+	}
+
+	this->ComputeNormals();
+}
+
+/*
+* Simulates as many fixed frame steps as fit into the wall-clock time
+* that passed, keeping the leftover for next time.
+* 
+* elapsedTime: seconds since the last call
+* returns: how many frame steps were taken (0 if not enough time passed)
+*/
+GLint ClothSimulation::Advance(GLfloat elapsedTime) {
+	ProfileScope scope(PHASE_SIMULATE);
+	GLint steps = scheduler.Advance(elapsedTime);
+	for (GLint i = 0; i < steps; i++) {
+		this->Update();
+	}
+	return steps;
+}
+
+/*
+* Takes care of computing all forces (gravity, spring-dampers, bending, 
+* aerodynamic drag) to each particle.
+* 
+* deltaTime: the size of the time step to take when integrating motion
+*/
+void ClothSimulation::ComputeForce(GLfloat deltaTime) {
+	if (forceMode == FORCE_COLORED) {
+		this->ComputeForceColored(deltaTime);
+		return;
+	}
+	if (forceMode == FORCE_GATHER) {
+		this->ComputeForceGather(deltaTime);
+		return;
+	}
+
+	// Apply gravity to each particle
+	{
+		ProfileScope scope(PHASE_GRAVITY);
+		GLint numParticles = particles.size();
+		for (GLint p = 0; p < numParticles; p++) {
+			// remember our units are 1 unit = 1 m. So 9.8 m for g
+			glm::vec3 gravityForce = particles.masses[p] * glm::vec3(0.0f, -09.8f, 0.0f);
+			particles.ApplyForce(p, gravityForce);
+		}
+	}
+
+	// apply each spring-damper's force
+	{
+		ProfileScope scope(PHASE_SPRINGS);
+		SpringDamper::ComputeForces(springDampers, particles);
+	}
+
+	// apply each aerodynamic force
+	ProfileScope scope(PHASE_AERO);
+	for (Triangle* t : triangles) {
+		t->ComputeForce();
+	}
+}
+
+/*
+* Same as the serial ComputeForce, but split across the shared thread pool. Every
+* color group of springs/triangles touches each particle at most once, so
+* the groups are run one after another and each one in parallel, with no
+* two threads ever adding into the same particle's force. Each chunk of a
+* color is evaluated with the SIMD spring kernel and then scattered onto
+* its particles.
+* 
+* deltaTime: the size of the time step to take when integrating motion
+*/
+void ClothSimulation::ComputeForceColored(GLfloat deltaTime) {
+	ThreadPool& pool = ThreadPool::Shared();
+
+	// gravity and aerodynamic drag
+	this->ComputeExternalForce();
+
+	// apply each spring-damper's force, one color at a time. The kernel is
+	// built from the colored table, so its indices are the table's.
+	ProfileScope scope(PHASE_SPRINGS);
+	for (size_t c = 0; c + 1 < springColors.size(); c++) {
+		GLint first = springColors[c];
+		pool.ParallelFor(springColors[c + 1] - first, parallelGrain, 
+			[this, first](int begin, int end) {
+				springKernel.Evaluate(particles, first + begin, first + end);
+				for (GLint i = first + begin; i < first + end; i++) {
+					glm::vec3 springForce = springKernel.getForce(i);
+					particles.ApplyForce(springKernel.P1[i], springForce);
+					particles.ApplyForce(springKernel.P2[i], -springForce);
+				}
+			});
+	}
+}
+
+/*
+* Applies every force that isn't a spring-damper (gravity, aerodynamic
+* drag), in parallel. Used on its own by the implicit integrator, which
+* handles the spring-dampers itself.
+*/
+void ClothSimulation::ComputeExternalForce() {
+	ThreadPool& pool = ThreadPool::Shared();
+
+	// Apply gravity to each particle
+	{
+		ProfileScope scope(PHASE_GRAVITY);
+		pool.ParallelFor(particles.size(), parallelGrain, [this](int begin, int end) {
+			for (GLint p = begin; p < end; p++) {
+				glm::vec3 gravityForce = particles.masses[p] * glm::vec3(0.0f, -09.8f, 0.0f);
+				particles.ApplyForce(p, gravityForce);
+			}
+		});
+	}
+
+	// apply each aerodynamic force, one color at a time. The kernel is
+	// built from the colored list, so its indices are the list's.
+	ProfileScope scope(PHASE_AERO);
+	for (size_t c = 0; c + 1 < triangleColors.size(); c++) {
+		GLint first = triangleColors[c];
+		pool.ParallelFor(triangleColors[c + 1] - first, parallelGrain,
+			[this, first](int begin, int end) {
+				triangleKernel.Evaluate(particles, airVelocity, first + begin, first + end);
+				for (GLint i = first + begin; i < first + end; i++) {
+					glm::vec3 dragForce = triangleKernel.getForce(i);
+					particles.ApplyForce(triangleKernel.P1[i], dragForce);
+					particles.ApplyForce(triangleKernel.P2[i], dragForce);
+					particles.ApplyForce(triangleKernel.P3[i], dragForce);
+				}
+			});
+	}
+}
+
+/*
+* Gather version of ComputeForce. Every spring-damper and triangle first
+* stores its force into its own slot, then every particle walks its
+* incident constraints and sums them up. Nothing is ever written by two
+* threads, so both passes are plain parallel loops.
+* 
+* deltaTime: the size of the time step to take when integrating motion
+*/
+void ClothSimulation::ComputeForceGather(GLfloat deltaTime) {
+	ThreadPool& pool = ThreadPool::Shared();
+
+	// evaluate each spring-damper's force on its first particle, many
+	// springs at a time with the SIMD kernel
+	{
+		ProfileScope scope(PHASE_SPRINGS);
+		pool.ParallelFor(springKernel.size(), parallelGrain, [this](int begin, int end) {
+			springKernel.Evaluate(particles, begin, end);
+		});
+	}
+
+	// evaluate each triangle's aerodynamic force share
+	{
+		ProfileScope scope(PHASE_AERO);
+		pool.ParallelFor(triangleKernel.size(), parallelGrain, [this](int begin, int end) {
+			triangleKernel.Evaluate(particles, airVelocity, begin, end);
+		});
+	}
+
+	// each particle sums gravity and its incident forces
+	ProfileScope scope(PHASE_GATHER);
+	pool.ParallelFor(particles.size(), parallelGrain, [this](int begin, int end) {
+		for (GLint p = begin; p < end; p++) {
+			glm::vec3 force = particles.masses[p] * glm::vec3(0.0f, -09.8f, 0.0f);
+
+			for (GLint e = springAdjacency.begin(p); e < springAdjacency.end(p); e++) {
+				GLint entry = springAdjacency.entries[e];
+				glm::vec3 springForce = springKernel.getForce(entry >> 1);
+				if (entry & 1) force -= springForce;
+				else force += springForce;
+			}
+
+			for (GLint e = triangleAdjacency.begin(p); e < triangleAdjacency.end(p); e++) {
+				force += triangleKernel.getForce(triangleAdjacency.entries[e]);
+			}
+
+			particles.ApplyForce(p, force);
+		}
+	});
+}
+
+/*
+* Recomputes every particle's normal as the normalized sum of the normals
+* of the triangles around it. The triangle normals are left in
+* triangleKernel, then each particle gathers its own over
+* triangleAdjacency, so both passes run in parallel with no two threads
+* writing the same normal.
+*/
+void ClothSimulation::ComputeNormals() {
+	ProfileScope scope(PHASE_NORMALS);
+	ThreadPool& pool = ThreadPool::Shared();
+
+	pool.ParallelFor(triangleKernel.size(), parallelGrain, [this](int begin, int end) {
+		triangleKernel.EvaluateNormals(particles, begin, end);
+	});
+
+	pool.ParallelFor(particles.size(), parallelGrain, [this](int begin, int end) {
+		for (GLint p = begin; p < end; p++) {
+			glm::vec3 normal(0.0f);
+			for (GLint e = triangleAdjacency.begin(p); e < triangleAdjacency.end(p); e++) {
+				normal += triangleKernel.getNormal(triangleAdjacency.entries[e]);
+			}
+			particles.normals[p] = glm::normalize(normal);
+		}
+	});
+}
+
+/*
+* Resolves collisions with the analytic colliders, in one batched pass
+* over all particles after they were integrated.
+*/
+void ClothSimulation::HandleCollisions() {
+	if (colliders.empty()) return;
+
+	ProfileScope scope(PHASE_COLLISION);
+
+	GLint numParticles = particles.size();
+	if (forceMode == FORCE_SERIAL) {
+		colliders.Resolve(particles, 0, numParticles);
+		return;
+	}
+
+	ThreadPool::Shared().ParallelFor(numParticles, parallelGrain, [this](int begin, int end) {
+		colliders.Resolve(particles, begin, end);
+	});
+}
+
+/*
+* Sweeps the particles' motion over one substep against every mesh
+* collider, each placed where it is during that part of the frame step.
+* 
+* substep, substeps: which of how many substeps of the frame step this is
+* deltaTime: length of the substep
+*/
+void ClothSimulation::HandleMeshCollisions(GLint substep, GLint substeps, GLfloat deltaTime) {
+	if (meshColliders.empty()) return;
+
+	ProfileScope scope(PHASE_COLLISION);
+	for (MeshCollider* collider : meshColliders) {
+		collider->BeginSubstep((GLfloat)substep / substeps, (GLfloat)(substep + 1) / substeps);
+		collider->Collide(particles, substepStart, deltaTime);
+	}
+}
+
+/*
+* Keeps the cloth from passing through itself, if enabled. Runs after
+* every substep, once the particles have moved.
+*/
+void ClothSimulation::HandleSelfCollisions() {
+	if (!selfCollision.enabled) return;
+
+	ProfileScope scope(PHASE_SELF_COLLISION);
+	selfCollision.Resolve(particles, triangles);
+}
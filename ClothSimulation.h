@@ -0,0 +1,144 @@
+#pragma once
+
+#include "SpringDamper.h"
+#include "Triangle.h"
+#include "ColliderSet.h"
+#include "ImplicitSolver.h"
+#include "MeshCollider.h"
+#include "ParticleAdjacency.h"
+#include "SelfCollision.h"
+#include "SpringKernel.h"
+#include "SubstepScheduler.h"
+#include "TriangleKernel.h"
+#include "ThreadPool.h"
+#include "XpbdSolver.h"
+
+// how ClothSimulation::ComputeForce accumulates the forces on each particle
+enum ForceMode {
+	FORCE_SERIAL,	// one thread, each constraint adds into its particles
+	FORCE_COLORED,	// same, one color group at a time across the thread pool
+	FORCE_GATHER	// constraint forces first, then each particle sums its own
+};
+
+// how ClothSimulation::Update steps the particles forward
+enum Integrator {
+	INTEGRATOR_EXPLICIT,	// many small semi-implicit Euler substeps
+	INTEGRATOR_IMPLICIT,	// a few backward Euler steps (ImplicitSolver)
+	INTEGRATOR_XPBD			// a few position based steps (XpbdSolver)
+};
+
+// one piece of fabric in ClothSimulation's shared arrays: how it was laid
+// out (AddCloth's arguments) and where its particles and triangles start
+struct ClothLayout {
+	GLfloat length, width;
+	GLint particlesL, particlesW;
+	glm::vec3 topLeftPos;
+	GLfloat mass;
+	GLfloat bending;				// spring constant of its bending springs
+
+	GLint firstParticle;			// particlesL * particlesW from here on
+	GLint firstIndex, numIndices;	// its part of indices
+};
+
+/*
+* The physics half of one or more pieces of fabric: particles,
+* spring-dampers, aerodynamic triangles and the integrators that step them.
+* Knows nothing about OpenGL or the tweak bar, so it can run without a
+* window (Cloth wraps one of these for drawing).
+*
+* Every cloth added lives in the same particle arrays and constraint
+* tables, so a scene with dozens of garments is stepped with one parallel
+* pass per phase, not one per garment, and they collide with each other
+* through the self-collision.
+*/
+class ClothSimulation
+{
+private:
+	// lists of actual particles' data
+	
+	// stretch, shear and bending springs, all in one table
+	std::vector<SpringDamper> springDampers;
+	std::vector<Triangle*> triangles;
+
+	// start offsets of each independent color group in springDampers and
+	// triangles (last entry is the list size)
+	std::vector<GLint> springColors;
+	std::vector<GLint> triangleColors;
+
+	// incident constraints of each particle and SIMD copies of
+	// springDampers and triangles, used by the gather force mode
+	ParticleAdjacency springAdjacency, triangleAdjacency;
+	SpringKernel springKernel;
+	TriangleKernel triangleKernel;
+
+	// the pieces of fabric, in the order they were added
+	std::vector<ClothLayout> cloths;
+
+	// particle positions at the start of the current substep, for the
+	// continuous mesh collisions
+	std::vector<glm::vec3> substepStart;
+
+	// saves and restores the private tables and layout
+	friend class Snapshot;
+
+public:
+	ParticleSystem particles;
+
+	// three particle indices per triangle, in draw order
+	std::vector<unsigned int> indices;
+
+	glm::vec3 airVelocity;
+
+	// how forces are accumulated; anything but FORCE_SERIAL also splits
+	// integration across the thread pool
+	ForceMode forceMode;
+
+	Integrator integrator;
+	GLint implicitSubsteps;	// backward Euler steps per frame
+	GLint xpbdSubsteps;		// XPBD steps per frame
+	ImplicitSolver implicitSolver;
+	XpbdSolver xpbdSolver;
+
+	SubstepScheduler scheduler;
+	GLint lastSubsteps;		// substeps the last Update took
+
+	SelfCollision selfCollision;
+
+	// analytic shapes the cloth collides with, a ground plane to start with
+	ColliderSet colliders;
+
+	// meshes the cloth collides with (not owned)
+	std::vector<MeshCollider*> meshColliders;
+
+	// spring constant of the bending springs unless told otherwise
+	static const GLfloat defaultBending;
+
+	// constructor for no cloth yet (see AddCloth) and for a piece of fabric
+	ClothSimulation(Integrator integrator = INTEGRATOR_EXPLICIT);
+	ClothSimulation(GLfloat clothLength, GLfloat clothWidth, GLint particlesL,
+		GLint particlesW, glm::vec3 topLeftPos, GLfloat clothMass,
+		GLfloat randomness, Integrator integrator = INTEGRATOR_EXPLICIT);
+	~ClothSimulation();
+
+	GLint AddCloth(GLfloat clothLength, GLfloat clothWidth, GLint particlesL,
+		GLint particlesW, glm::vec3 topLeftPos, GLfloat clothMass, GLfloat randomness,
+		GLfloat bending = defaultBending);
+	void BuildTables();
+
+	void Update();
+	GLint Advance(GLfloat elapsedTime);
+
+	void ComputeForce(GLfloat deltaTime);
+	void ComputeExternalForce();
+	void ComputeForceColored(GLfloat deltaTime);
+	void ComputeForceGather(GLfloat deltaTime);
+	void ComputeNormals();
+	void HandleCollisions();
+	void HandleMeshCollisions(GLint substep, GLint substeps, GLfloat deltaTime);
+	void HandleSelfCollisions();
+
+	// read-only views of the constraint lists (benchmarks, exporters)
+	const std::vector<SpringDamper>& getSpringDampers() const { return springDampers; }
+	const std::vector<Triangle*>& getTriangles() const { return triangles; }
+	const std::vector<ClothLayout>& getCloths() const { return cloths; }
+};
@@ -0,0 +1,147 @@
+#include "ColliderSet.h"
+
+#include <cmath>
+
+ColliderSet::ColliderSet() {
+	this->restitution = 0.5f;
+	this->friction = 0.75f;
+}
+
+/*
+* point: any point on the plane
+* normal: direction of the free side, need not be unit length
+*/
+void ColliderSet::AddPlane(const glm::vec3& point, const glm::vec3& normal) {
+	Plane plane;
+	plane.point = point;
+	plane.normal = glm::normalize(normal);
+	planes.push_back(plane);
+}
+
+void ColliderSet::AddSphere(const glm::vec3& center, GLfloat radius) {
+	Sphere sphere;
+	sphere.center = center;
+	sphere.radius = radius;
+	spheres.push_back(sphere);
+}
+
+/*
+* a, b: ends of the segment the capsule is rounded around
+* radius: distance of the surface from the segment
+*/
+void ColliderSet::AddCapsule(const glm::vec3& a, const glm::vec3& b, GLfloat radius) {
+	Capsule capsule;
+	capsule.a = a;
+	capsule.b = b;
+	capsule.radius = radius;
+	capsules.push_back(capsule);
+}
+
+/*
+* center: middle of the box
+* halfExtents: half the box's size along each of its axes
+* axes: orientation, columns are the box's unit x, y and z axes
+*/
+void ColliderSet::AddBox(const glm::vec3& center, const glm::vec3& halfExtents,
+	const glm::mat3& axes) {
+	Box box;
+	box.center = center;
+	box.axes = axes;
+	box.halfExtents = halfExtents;
+	boxes.push_back(box);
+}
+
+void ColliderSet::Clear() {
+	planes.clear();
+	spheres.clear();
+	capsules.clear();
+	boxes.clear();
+}
+
+/*
+* Pushes every free particle in [begin, end) out of every shape. Shapes
+* are taken one after another, each over the whole range; pinned
+* particles are left where they are.
+*
+* particles: store to fix up, right after integration
+* begin, end: range of particle indices to handle
+*/
+void ColliderSet::Resolve(ParticleSystem& particles, GLint begin, GLint end) const {
+	const std::vector<glm::vec3>& positions = particles.positions;
+	const std::vector<unsigned char>& pinned = particles.pinned;
+
+	for (const Plane& plane : planes) {
+		for (GLint p = begin; p < end; p++) {
+			GLfloat distance = glm::dot(positions[p] - plane.point, plane.normal);
+			if (distance < 0.0f && !pinned[p]) this->Respond(particles, p, plane.normal, -distance);
+		}
+	}
+
+	for (const Sphere& sphere : spheres) {
+		GLfloat radiusSq = sphere.radius * sphere.radius;
+		for (GLint p = begin; p < end; p++) {
+			glm::vec3 offset = positions[p] - sphere.center;
+			GLfloat distanceSq = glm::dot(offset, offset);
+			if (distanceSq < radiusSq && distanceSq > 0.0f && !pinned[p]) {
+				GLfloat distance = std::sqrt(distanceSq);
+				this->Respond(particles, p, offset / distance, sphere.radius - distance);
+			}
+		}
+	}
+
+	for (const Capsule& capsule : capsules) {
+		glm::vec3 axis = capsule.b - capsule.a;
+		GLfloat axisLengthSq = glm::dot(axis, axis);
+		GLfloat inverseLengthSq = axisLengthSq > 0.0f ? 1.0f / axisLengthSq : 0.0f;
+		GLfloat radiusSq = capsule.radius * capsule.radius;
+		for (GLint p = begin; p < end; p++) {
+			// closest point on the core segment
+			GLfloat t = glm::clamp(glm::dot(positions[p] - capsule.a, axis) * inverseLengthSq, 0.0f, 1.0f);
+			glm::vec3 offset = positions[p] - (capsule.a + t * axis);
+			GLfloat distanceSq = glm::dot(offset, offset);
+			if (distanceSq < radiusSq && distanceSq > 0.0f && !pinned[p]) {
+				GLfloat distance = std::sqrt(distanceSq);
+				this->Respond(particles, p, offset / distance, capsule.radius - distance);
+			}
+		}
+	}
+
+	for (const Box& box : boxes) {
+		for (GLint p = begin; p < end; p++) {
+			// how far inside each pair of faces, in the box's own frame
+			glm::vec3 offset = positions[p] - box.center;
+			glm::vec3 local(glm::dot(offset, box.axes[0]), glm::dot(offset, box.axes[1]),
+				glm::dot(offset, box.axes[2]));
+			glm::vec3 depths = box.halfExtents - glm::abs(local);
+			if (depths.x <= 0.0f || depths.y <= 0.0f || depths.z <= 0.0f || pinned[p]) continue;
+
+			// out through the nearest face
+			int axis = 0;
+			if (depths.y < depths[axis]) axis = 1;
+			if (depths.z < depths[axis]) axis = 2;
+			glm::vec3 normal = local[axis] < 0.0f ? -box.axes[axis] : box.axes[axis];
+			this->Respond(particles, p, normal, depths[axis]);
+		}
+	}
+}
+
+/*
+* Moves one particle depth along normal, back onto the surface, and
+* bounces and slows down its velocity if it was moving into the surface.
+*/
+void ColliderSet::Respond(ParticleSystem& particles, GLint index, const glm::vec3& normal,
+	GLfloat depth) const {
+	particles.positions[index] += depth * normal;
+
+	glm::vec3& velocity = particles.velocities[index];
+	GLfloat approach = glm::dot(velocity, normal);
+	if (approach >= 0.0f) return;
+
+	glm::vec3 sliding = velocity - approach * normal;
+	GLfloat speed = glm::length(sliding);
+	GLfloat keep = 0.0f;
+	if (speed > 0.0f) {
+		keep = glm::max(0.0f, 1.0f - friction * (1.0f + restitution) * -approach / speed);
+	}
+	velocity = keep * sliding - restitution * approach * normal;
+}
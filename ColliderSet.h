@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ParticleSystem.h"
+
+/*
+* Analytic shapes the cloth collides with (ground planes, spheres,
+* capsules, oriented boxes), kept apart from the particles. Resolve runs
+* once over a whole range of particles after integration, one shape at a
+* time, so the inner loops are the same few instructions for every
+* particle.
+*
+* A particle found inside a shape is moved to its surface; the velocity
+* into the surface is bounced back by restitution and the sliding
+* velocity slowed by friction.
+*/
+class ColliderSet
+{
+public:
+	struct Plane {
+		glm::vec3 point;
+		glm::vec3 normal;		// unit length, pointing to the free side
+	};
+	struct Sphere {
+		glm::vec3 center;
+		GLfloat radius;
+	};
+	struct Capsule {
+		glm::vec3 a, b;			// ends of the core segment
+		GLfloat radius;
+	};
+	struct Box {
+		glm::vec3 center;
+		glm::mat3 axes;			// unit columns, the box's local x, y, z
+		glm::vec3 halfExtents;
+	};
+
+	std::vector<Plane> planes;
+	std::vector<Sphere> spheres;
+	std::vector<Capsule> capsules;
+	std::vector<Box> boxes;
+
+	GLfloat restitution;	// share of the approach speed bounced back
+	GLfloat friction;		// Coulomb coefficient against sliding
+
+	ColliderSet();
+
+	void AddPlane(const glm::vec3& point, const glm::vec3& normal);
+	void AddSphere(const glm::vec3& center, GLfloat radius);
+	void AddCapsule(const glm::vec3& a, const glm::vec3& b, GLfloat radius);
+	void AddBox(const glm::vec3& center, const glm::vec3& halfExtents,
+		const glm::mat3& axes = glm::mat3(1.0f));
+	void Clear();
+
+	bool empty() const {
+		return planes.empty() && spheres.empty() && capsules.empty() && boxes.empty();
+	}
+
+	void Resolve(ParticleSystem& particles, GLint begin, GLint end) const;
+
+private:
+	void Respond(ParticleSystem& particles, GLint index, const glm::vec3& normal,
+		GLfloat depth) const;
+};
@@ -0,0 +1,48 @@
+#include "CpuFeatures.h"
+
+#if defined(CLOTH_X86_SIMD) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+
+// MSVC has no __builtin_cpu_supports, so read CPUID and check that the OS
+// saves the wide registers on context switches
+static bool QueryMSVC(int leaf7Bit, unsigned long long xcrMask) {
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!osxsave) return false;
+	if ((_xgetbv(0) & xcrMask) != xcrMask) return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << leaf7Bit)) != 0;
+}
+#endif
+
+bool CpuFeatures::HasAVX2() {
+#if !defined(CLOTH_X86_SIMD)
+	return false;
+#elif defined(_MSC_VER)
+	static const bool supported = QueryMSVC(5, 0x6);
+	return supported;
+#else
+	__builtin_cpu_init();
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+#endif
+}
+
+bool CpuFeatures::HasAVX512() {
+#if !defined(CLOTH_X86_SIMD)
+	return false;
+#elif defined(_MSC_VER)
+	static const bool supported = QueryMSVC(16, 0xE6);
+	return supported;
+#else
+	__builtin_cpu_init();
+	static const bool supported = __builtin_cpu_supports("avx512f");
+	return supported;
+#endif
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+/*
+* Runtime detection of the SIMD instruction sets the simulation kernels
+* can use. Results are queried once and cached.
+*/
+class CpuFeatures
+{
+public:
+	static bool HasAVX2();
+	static bool HasAVX512();
+};
+
+// x86 targets get the AVX kernels, everything else only the scalar ones
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CLOTH_X86_SIMD 1
+#endif
+
+// lets a single function use AVX instructions without compiling the whole
+// file for them, so it can still run on older CPUs (MSVC doesn't need it)
+#if defined(CLOTH_X86_SIMD) && !defined(_MSC_VER)
+#define CLOTH_TARGET_AVX2 __attribute__((target("avx2")))
+#define CLOTH_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define CLOTH_TARGET_AVX2
+#define CLOTH_TARGET_AVX512
+#endif
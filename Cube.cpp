@@ -101,6 +101,8 @@ Cube::Cube(glm::vec3 cubeMin, glm::vec3 cubeMax)
 		20,21,22,	20,22,23,		// Right
 	};
 
+	collider.Build(positions, indices, model);
+
 
 	// Generate a vertex array (VAO) and two vertex buffer objects (VBO).
 	glGenVertexArrays(1, &VAO);
@@ -145,17 +147,17 @@ Cube::~Cube()
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void Cube::draw(const glm::mat4& viewProjMtx, GLuint shader)
+void Cube::draw(const glm::mat4& viewProjMtx, GLuint shader, const ShaderUniforms& uniforms)
 {
 	// actiavte the shader program 
 	glUseProgram(shader);
 
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-	// get the locations and send the uniforms to the shader 
-	glUniformMatrix4fv(glGetUniformLocation(shader, "viewProj"), 1, false, (float*)&viewProjMtx);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, (float*)&model);
-	glUniform3fv(glGetUniformLocation(shader, "DiffuseColor"), 1, &color[0]);
+	// send the uniforms to the shader, at the locations looked up at load
+	glUniformMatrix4fv(uniforms.viewProj, 1, false, (float*)&viewProjMtx);
+	glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, (float*)&model);
+	glUniform3fv(uniforms.diffuseColor, 1, &color[0]);
 
 	// Bind the VAO
 	glBindVertexArray(VAO);
@@ -182,6 +184,7 @@ void Cube::spin(float deg)
 {
 	// Update the model matrix by multiplying a rotation matrix
 	model = model * glm::rotate(glm::radians(deg), glm::vec3(0.0f, 1.0f, 0.0f));
+	collider.SetTransform(model);
 }
 
 
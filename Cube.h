@@ -2,6 +2,8 @@
 #define _CUBE_H_
 
 #include "core.h"
+#include "MeshCollider.h"
+#include "shader.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -20,10 +22,13 @@ private:
 	std::vector<unsigned int> indices;
 
 public:
+	// the cube as something the cloth collides with, kept at model
+	MeshCollider collider;
+
 	Cube(glm::vec3 cubeMin=glm::vec3(-1,-1,-1), glm::vec3 cubeMax=glm::vec3(1, 1, 1));
 	~Cube();
 
-	void draw(const glm::mat4& viewProjMtx, GLuint shader);
+	void draw(const glm::mat4& viewProjMtx, GLuint shader, const ShaderUniforms& uniforms);
 	void update();
 
 	void spin(float deg);
@@ -0,0 +1,197 @@
+#include "ImplicitSolver.h"
+
+#include <algorithm>
+
+// smallest number of loop iterations worth handing to another thread
+static const GLint parallelGrain = 512;
+
+static GLfloat Dot(const std::vector<glm::vec3>& a, const std::vector<glm::vec3>& b) {
+	double sum = 0.0;
+	for (size_t i = 0; i < a.size(); i++) {
+		sum += glm::dot(a[i], b[i]);
+	}
+	return (GLfloat)sum;
+}
+
+/*
+* Constructor.
+*/
+ImplicitSolver::ImplicitSolver() {
+	this->maxIterations = 100;
+	this->tolerance = 1e-4f;
+	this->lastIterations = 0;
+}
+
+/*
+* Takes one backward Euler step of every particle. Forces already stored
+* in particles.forces are included explicitly and reset afterwards, just
+* like ParticleSystem::Integrate does.
+* 
+* particles: store to step forward
+* springs: spring-damper table integrated implicitly
+* adjacency: incident spring-dampers of each particle
+* deltaTime: the size of the time step to take forward in time
+*/
+void ImplicitSolver::Step(ParticleSystem& particles, const std::vector<SpringDamper>& springs,
+	const ParticleAdjacency& adjacency, GLfloat deltaTime) {
+	GLint numParticles = particles.size();
+	ThreadPool& pool = ThreadPool::Shared();
+
+	rhs.resize(numParticles);
+	dv.assign(numParticles, glm::vec3(0.0f));
+	r.resize(numParticles);
+	z.resize(numParticles);
+	p.resize(numParticles);
+	q.resize(numParticles);
+
+	this->Assemble(particles, springs, adjacency, deltaTime);
+
+	// preconditioned conjugate gradients, starting from dv = 0. Fixed
+	// particles have zero rows so their dv stays zero
+	r = rhs;
+	this->Precondition(particles);
+	p = z;
+	GLfloat rz = Dot(r, z);
+	GLfloat stopResidual = tolerance * tolerance * Dot(rhs, rhs);
+
+	GLint iteration = 0;
+	while (iteration < maxIterations && Dot(r, r) > stopResidual) {
+		this->Multiply(particles, springs, adjacency, p, q);
+
+		GLfloat pq = Dot(p, q);
+		if (pq <= 0.0f) break;
+		GLfloat alpha = rz / pq;
+
+		for (GLint i = 0; i < numParticles; i++) {
+			dv[i] += alpha * p[i];
+			r[i] -= alpha * q[i];
+		}
+
+		this->Precondition(particles);
+		GLfloat rzNew = Dot(r, z);
+		GLfloat beta = rzNew / rz;
+		rz = rzNew;
+
+		for (GLint i = 0; i < numParticles; i++) {
+			p[i] = z[i] + beta * p[i];
+		}
+
+		iteration++;
+	}
+	this->lastIterations = iteration;
+
+	// update velocities, then positions with the new velocities
+	pool.ParallelFor(numParticles, parallelGrain, [&](int begin, int end) {
+		for (GLint i = begin; i < end; i++) {
+			if (!particles.pinned[i]) {
+				particles.velocities[i] += dv[i];
+				particles.positions[i] += particles.velocities[i] * deltaTime;
+			}
+			particles.forces[i] = glm::vec3(0.0f);
+		}
+	});
+}
+
+/*
+* Builds the blocks of A and the right-hand side h (f + h df/dx v).
+*/
+void ImplicitSolver::Assemble(const ParticleSystem& particles, 
+	const std::vector<SpringDamper>& springs, const ParticleAdjacency& adjacency,
+	GLfloat deltaTime) {
+	GLint numParticles = particles.size();
+	GLint numSprings = (GLint)springs.size();
+	ThreadPool& pool = ThreadPool::Shared();
+	GLfloat h = deltaTime;
+
+	springBlocks.resize(numSprings);
+	springForces.resize(numSprings);
+	springJv.resize(numSprings);
+	diagonal.resize(numParticles);
+	preconditioner.resize(numParticles);
+
+	// each spring-damper's Jacobians only depend on its own two particles
+	pool.ParallelFor(numSprings, parallelGrain, [&](int begin, int end) {
+		const glm::mat3 identity(1.0f);
+
+		for (GLint s = begin; s < end; s++) {
+			const SpringDamper& sd = springs[s];
+			glm::vec3 x12 = particles.positions[sd.P1] - particles.positions[sd.P2];
+			GLfloat currentLength = glm::length(x12);
+			glm::vec3 e = x12 / currentLength;
+			glm::mat3 eeT = glm::outerProduct(e, e);
+
+			// df1/dx1. The transverse term is dropped under compression so
+			// the matrix stays definite (Choi & Ko)
+			GLfloat stretchRatio = std::max(0.0f, 1.0f - sd.restLength / currentLength);
+			glm::mat3 dfdx = (-sd.springConstant) * (eeT + stretchRatio * (identity - eeT));
+			// df1/dv1
+			glm::mat3 dfdv = (-sd.dampingConstant) * eeT;
+
+			springBlocks[s] = (-h) * dfdv - (h * h) * dfdx;
+			springForces[s] = sd.EvaluateForce(particles);
+			springJv[s] = dfdx * (particles.velocities[sd.P1] - particles.velocities[sd.P2]);
+		}
+	});
+
+	// gather the diagonal blocks and right-hand side of each particle
+	pool.ParallelFor(numParticles, parallelGrain, [&](int begin, int end) {
+		for (GLint i = begin; i < end; i++) {
+			glm::mat3 block = particles.masses[i] * glm::mat3(1.0f);
+			glm::vec3 force = particles.forces[i];
+			glm::vec3 jv = glm::vec3(0.0f);
+
+			for (GLint e = adjacency.begin(i); e < adjacency.end(i); e++) {
+				GLint entry = adjacency.entries[e];
+				GLint s = entry >> 1;
+				block = block + springBlocks[s];
+				if (entry & 1) {
+					force -= springForces[s];
+					jv -= springJv[s];
+				}
+				else {
+					force += springForces[s];
+					jv += springJv[s];
+				}
+			}
+
+			diagonal[i] = block;
+			preconditioner[i] = glm::inverse(block);
+			rhs[i] = particles.pinned[i] ? glm::vec3(0.0f) : h * (force + h * jv);
+		}
+	});
+}
+
+/*
+* result = A x, with the rows of fixed particles zeroed.
+*/
+void ImplicitSolver::Multiply(const ParticleSystem& particles, 
+	const std::vector<SpringDamper>& springs, const ParticleAdjacency& adjacency,
+	const std::vector<glm::vec3>& x, std::vector<glm::vec3>& result) {
+	ThreadPool::Shared().ParallelFor(particles.size(), parallelGrain, [&](int begin, int end) {
+		for (GLint i = begin; i < end; i++) {
+			if (particles.pinned[i]) {
+				result[i] = glm::vec3(0.0f);
+				continue;
+			}
+
+			glm::vec3 sum = diagonal[i] * x[i];
+			for (GLint e = adjacency.begin(i); e < adjacency.end(i); e++) {
+				GLint entry = adjacency.entries[e];
+				const SpringDamper& sd = springs[entry >> 1];
+				GLint other = (entry & 1) ? sd.P1 : sd.P2;
+				sum -= springBlocks[entry >> 1] * x[other];
+			}
+			result[i] = sum;
+		}
+	});
+}
+
+/*
+* z = P^-1 r using the inverted diagonal blocks.
+*/
+void ImplicitSolver::Precondition(const ParticleSystem& particles) {
+	GLint numParticles = particles.size();
+	for (GLint i = 0; i < numParticles; i++) {
+		z[i] = particles.pinned[i] ? glm::vec3(0.0f) : preconditioner[i] * r[i];
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ParticleAdjacency.h"
+#include "ThreadPool.h"
+
+/*
+* Backward Euler integrator in the style of Baraff & Witkin, "Large Steps
+* in Cloth Simulation". Spring-dampers are integrated implicitly: their
+* Jacobians are assembled into a sparse block matrix
+* 
+*     A = M - h df/dv - h^2 df/dx
+* 
+* with one 3x3 block per particle (diagonal) and one per spring-damper
+* (off-diagonal), and A dv = h (f + h df/dx v) is solved with block-Jacobi
+* preconditioned conjugate gradients. Forces already accumulated on the
+* particles (gravity, drag) are treated explicitly.
+*/
+class ImplicitSolver
+{
+public:
+	GLint maxIterations;
+	GLfloat tolerance;		// relative residual to stop at
+
+	GLint lastIterations;	// CG iterations the last Step took
+
+	ImplicitSolver();
+
+	void Step(ParticleSystem& particles, const std::vector<SpringDamper>& springs,
+		const ParticleAdjacency& adjacency, GLfloat deltaTime);
+
+private:
+	// per spring-damper: off-diagonal block, force on P1 and df/dx (v1 - v2)
+	std::vector<glm::mat3> springBlocks;
+	std::vector<glm::vec3> springForces;
+	std::vector<glm::vec3> springJv;
+
+	// per particle: diagonal block inverse, right-hand side and CG vectors
+	std::vector<glm::mat3> diagonal;
+	std::vector<glm::mat3> preconditioner;
+	std::vector<glm::vec3> rhs, dv, r, z, p, q;
+
+	void Assemble(const ParticleSystem& particles, const std::vector<SpringDamper>& springs,
+		const ParticleAdjacency& adjacency, GLfloat deltaTime);
+	void Multiply(const ParticleSystem& particles, const std::vector<SpringDamper>& springs,
+		const ParticleAdjacency& adjacency, const std::vector<glm::vec3>& x,
+		std::vector<glm::vec3>& result);
+	void Precondition(const ParticleSystem& particles);
+};
@@ -0,0 +1,78 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+	this->bytes = nullptr;
+	this->length = 0;
+}
+
+MappedFile::~MappedFile() {
+	this->Close();
+}
+
+/*
+* Maps a file, replacing whatever was mapped before. The file's handles
+* are closed again right away, the mapping keeps its pages alive.
+*
+* path: file to map
+* returns: false if the file can't be opened or is empty
+*/
+bool MappedFile::Open(const std::string& path) {
+	this->Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	CloseHandle(file);
+	if (mapping == NULL) return false;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == NULL) return false;
+	this->length = (size_t)fileSize.QuadPart;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) return false;
+
+	struct stat status;
+	void* view = MAP_FAILED;
+	if (fstat(file, &status) == 0 && status.st_size > 0) {
+		view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	close(file);
+	if (view == MAP_FAILED) return false;
+	this->length = (size_t)status.st_size;
+#endif
+
+	this->bytes = (const unsigned char*)view;
+	return true;
+}
+
+void MappedFile::Close() {
+	if (!bytes) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(bytes);
+#else
+	munmap((void*)bytes, length);
+#endif
+	this->bytes = nullptr;
+	this->length = 0;
+}
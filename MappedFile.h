@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*
+* Read-only view of a whole file mapped into memory. Nothing is read up
+* front: pages come in from the OS file cache the first time they are
+* touched, so opening a large file costs about as much as opening a small
+* one, and several processes mapping the same file share its pages.
+*/
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const std::string& path);
+	void Close();
+
+	bool isOpen() const { return bytes != nullptr; }
+	const unsigned char* data() const { return bytes; }
+	size_t size() const { return length; }
+
+private:
+	const unsigned char* bytes;
+	size_t length;
+
+	// one mapping per object
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
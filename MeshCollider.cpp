@@ -0,0 +1,221 @@
+#include "MeshCollider.h"
+
+#include "ThreadPool.h"
+
+// smallest number of particles worth handing to another thread
+static const GLint collisionGrain = 512;
+
+/*
+* Whether the projection of point onto triangle abc (normal n) falls
+* inside it.
+*/
+static bool ProjectsInside(const glm::vec3& point, const glm::vec3& a, const glm::vec3& b,
+	const glm::vec3& c, const glm::vec3& n) {
+	// each edge must have the point on its inner side
+	return glm::dot(glm::cross(b - a, point - a), n) >= 0.0f &&
+		glm::dot(glm::cross(c - b, point - b), n) >= 0.0f &&
+		glm::dot(glm::cross(a - c, point - c), n) >= 0.0f;
+}
+
+MeshCollider::MeshCollider() {
+	this->thickness = 0.02f;
+	this->friction = 0.5f;
+	this->lastContacts = 0;
+	this->moving = false;
+	this->prepared = false;
+}
+
+/*
+* Takes the mesh to collide with and builds its hierarchy.
+*
+* vertices: vertex positions, in the space transform maps to the world
+* indices: three vertex indices per triangle, counter-clockwise from outside
+* transform: where the mesh starts out
+*/
+void MeshCollider::Build(const std::vector<glm::vec3>& vertices,
+	const std::vector<unsigned int>& indices, const glm::mat4& transform) {
+	localVertices = vertices;
+	this->indices.assign(indices.begin(), indices.end());
+
+	frameEnd.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		frameEnd[i] = glm::vec3(transform * glm::vec4(vertices[i], 1.0f));
+	}
+	frameStart = frameEnd;
+	stepStart = frameEnd;
+	stepEnd = frameEnd;
+	this->moving = false;
+
+	this->UpdateTriangles();
+	bvh.Build(lows, highs);
+	this->prepared = true;
+}
+
+/*
+* Moves a rigid mesh: its Build vertices are mapped by transform, and the
+* mesh gets there by the end of the next frame step.
+*
+* transform: model matrix of the mesh
+*/
+void MeshCollider::SetTransform(const glm::mat4& transform) {
+	for (size_t i = 0; i < localVertices.size(); i++) {
+		frameEnd[i] = glm::vec3(transform * glm::vec4(localVertices[i], 1.0f));
+	}
+	this->moving = true;
+	this->prepared = false;
+}
+
+/*
+* Moves the vertices of a deforming mesh (e.g. a skinned character); the
+* triangles stay the same ones.
+*
+* vertices: new world space positions, as many as Build was given
+*/
+void MeshCollider::SetVertices(const std::vector<glm::vec3>& vertices) {
+	frameEnd = vertices;
+	this->moving = true;
+	this->prepared = false;
+}
+
+/*
+* Places the mesh for one substep, spanning the fraction [from, to] of the
+* frame step, and refits the hierarchy around that motion. Does nothing
+* for a mesh that is standing still.
+*/
+void MeshCollider::BeginSubstep(GLfloat from, GLfloat to) {
+	if (prepared) return;
+
+	if (moving) {
+		for (size_t i = 0; i < frameEnd.size(); i++) {
+			stepStart[i] = glm::mix(frameStart[i], frameEnd[i], from);
+			stepEnd[i] = glm::mix(frameStart[i], frameEnd[i], to);
+		}
+	}
+	else {
+		stepStart = frameEnd;
+		stepEnd = frameEnd;
+	}
+
+	this->UpdateTriangles();
+	bvh.Refit(lows, highs);
+	this->prepared = !moving;
+}
+
+/*
+* Done with a frame step: the mesh is now where it was moved to.
+*/
+void MeshCollider::EndFrame() {
+	if (!moving) return;
+
+	frameStart = frameEnd;
+	this->moving = false;
+	this->prepared = false;
+}
+
+/*
+* Normals, centroid motion and swept bounds of every triangle for the
+* current substep.
+*/
+void MeshCollider::UpdateTriangles() {
+	GLint numTriangles = (GLint)indices.size() / 3;
+	normals.resize(numTriangles);
+	shifts.resize(numTriangles);
+	lows.resize(numTriangles);
+	highs.resize(numTriangles);
+
+	for (GLint t = 0; t < numTriangles; t++) {
+		GLint a = indices[3 * t], b = indices[3 * t + 1], c = indices[3 * t + 2];
+		const glm::vec3& a0 = stepStart[a], &b0 = stepStart[b], &c0 = stepStart[c];
+		const glm::vec3& a1 = stepEnd[a], &b1 = stepEnd[b], &c1 = stepEnd[c];
+
+		glm::vec3 n = glm::cross(b1 - a1, c1 - a1);
+		GLfloat length = glm::length(n);
+		normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+		shifts[t] = ((a1 + b1 + c1) - (a0 + b0 + c0)) / 3.0f;
+
+		lows[t] = glm::min(glm::min(glm::min(a0, b0), glm::min(c0, a1)), glm::min(b1, c1)) - glm::vec3(thickness);
+		highs[t] = glm::max(glm::max(glm::max(a0, b0), glm::max(c0, a1)), glm::max(b1, c1)) + glm::vec3(thickness);
+	}
+}
+
+/*
+* Sweeps every free particle from where it started the substep to where
+* it is now. Of the triangles it comes within thickness of from the front,
+* the one it reaches first pushes it back out along the normal; the
+* velocity into the surface is removed and the sliding velocity slowed by
+* friction, both relative to the triangle's own motion.
+*
+* particles: store to fix up, right after integration
+* startPositions: particle positions at the start of the substep
+* deltaTime: length of the substep
+*/
+void MeshCollider::Collide(ParticleSystem& particles, const std::vector<glm::vec3>& startPositions,
+	GLfloat deltaTime) {
+	GLint numParticles = particles.size();
+	contacts.assign(numParticles, 0);
+	if (indices.empty()) {
+		this->lastContacts = 0;
+		return;
+	}
+
+	ThreadPool::Shared().ParallelFor(numParticles, collisionGrain, [&](int begin, int end) {
+		for (GLint p = begin; p < end; p++) {
+			if (particles.pinned[p]) continue;
+
+			const glm::vec3& x0 = startPositions[p];
+			const glm::vec3& x1 = particles.positions[p];
+			glm::vec3 low = glm::min(x0, x1) - glm::vec3(thickness);
+			glm::vec3 high = glm::max(x0, x1) + glm::vec3(thickness);
+
+			GLint hit = -1;
+			GLfloat hitTime = 2.0f, hitDistance = 0.0f;
+			bvh.Query(low, high, [&](GLint t) {
+				const glm::vec3& n = normals[t];
+				const glm::vec3& a = stepEnd[indices[3 * t]];
+
+				// start point as seen by a triangle standing still at its end pose
+				glm::vec3 start = x0 + shifts[t];
+				GLfloat d0 = glm::dot(start - a, n);
+				GLfloat d1 = glm::dot(x1 - a, n);
+				if (!(d1 < thickness) || d0 < -thickness) return;
+
+				// when it first came within thickness; a particle that
+				// already was is judged by where it ended up
+				GLfloat time = 0.0f;
+				glm::vec3 point = x1;
+				if (d0 > thickness) {
+					time = (d0 - thickness) / (d0 - d1);
+					point = start + time * (x1 - start);
+				}
+				if (time >= hitTime) return;
+
+				const glm::vec3& b = stepEnd[indices[3 * t + 1]];
+				const glm::vec3& c = stepEnd[indices[3 * t + 2]];
+				if (!ProjectsInside(point, a, b, c, n)) return;
+
+				hit = t;
+				hitTime = time;
+				hitDistance = d1;
+			});
+			if (hit < 0) continue;
+
+			const glm::vec3& n = normals[hit];
+			particles.positions[p] += (thickness - hitDistance) * n;
+
+			glm::vec3 surfaceVelocity = shifts[hit] / deltaTime;
+			glm::vec3 relative = particles.velocities[p] - surfaceVelocity;
+			GLfloat approach = glm::dot(relative, n);
+			if (approach < 0.0f) {
+				glm::vec3 sliding = relative - approach * n;
+				GLfloat speed = glm::length(sliding);
+				GLfloat keep = speed > 0.0f ? glm::max(0.0f, 1.0f - friction * -approach / speed) : 0.0f;
+				particles.velocities[p] = surfaceVelocity + keep * sliding;
+			}
+			contacts[p] = 1;
+		}
+	});
+
+	GLint total = 0;
+	for (GLint p = 0; p < numParticles; p++) total += contacts[p];
+	this->lastContacts = total;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Bvh.h"
+#include "ParticleSystem.h"
+
+/*
+* Static or animated triangle mesh the cloth collides with (furniture, a
+* character, the ground slab). The mesh's triangles sit in a Bvh that is
+* refit, not rebuilt, when the mesh moves. Triangles are one sided: their
+* winding (counter-clockwise seen from outside) says which side is free.
+*
+* Collisions are continuous: each particle's motion over a substep is
+* swept against the triangles, relative to their own motion, so fast
+* particles and fast meshes can't tunnel through thin parts. A mesh moved
+* with SetTransform or SetVertices travels there over the next frame step.
+*
+* While a SimulationThread runs, move colliders through its Post.
+*/
+class MeshCollider
+{
+public:
+	GLfloat thickness;		// particles are kept this far in front of the surface
+	GLfloat friction;		// Coulomb coefficient against sliding
+	GLint lastContacts;		// particles pushed out by the last Collide
+
+	MeshCollider();
+
+	void Build(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices,
+		const glm::mat4& transform = glm::mat4(1.0f));
+	void SetTransform(const glm::mat4& transform);
+	void SetVertices(const std::vector<glm::vec3>& vertices);
+
+	void BeginSubstep(GLfloat from, GLfloat to);
+	void Collide(ParticleSystem& particles, const std::vector<glm::vec3>& startPositions,
+		GLfloat deltaTime);
+	void EndFrame();
+
+private:
+	std::vector<glm::vec3> localVertices;	// as given to Build, for SetTransform
+	std::vector<GLint> indices;
+
+	// world space vertices where the frame step starts and ends, and over
+	// the current substep
+	std::vector<glm::vec3> frameStart, frameEnd;
+	std::vector<glm::vec3> stepStart, stepEnd;
+	bool moving;		// frameEnd differs from frameStart
+	bool prepared;		// step arrays are up to date
+
+	// per triangle, for the current substep: normal at the end, how far
+	// the centroid moves, and bounds over the whole motion
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec3> shifts;
+	std::vector<glm::vec3> lows, highs;
+	Bvh bvh;
+
+	std::vector<unsigned char> contacts;
+
+	void UpdateTriangles();
+};
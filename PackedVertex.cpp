@@ -0,0 +1,82 @@
+#include "PackedVertex.h"
+
+#include "ThreadPool.h"
+
+#include <cfloat>
+
+// smallest number of vertices worth handing to another thread
+static const GLint packGrain = 4096;
+
+/*
+* Packs a unit vector into three signed 10-bit fields (x lowest), with
+* the top two bits left at zero.
+*/
+GLuint PackedVertex::PackNormal(const glm::vec3& normal) {
+	GLuint packed = 0;
+	for (int i = 0; i < 3; i++) {
+		GLint value = (GLint)glm::round(glm::clamp(normal[i], -1.0f, 1.0f) * 511.0f);
+		packed |= ((GLuint)value & 0x3FFu) << (10 * i);
+	}
+	return packed;
+}
+
+glm::vec3 PackedVertex::UnpackNormal(GLuint packed) {
+	glm::vec3 normal;
+	for (int i = 0; i < 3; i++) {
+		// sign extend the 10-bit field
+		GLint value = (GLint)((packed >> (10 * i)) & 0x3FFu);
+		if (value & 0x200) value -= 0x400;
+		normal[i] = glm::max(value / 511.0f, -1.0f);
+	}
+	return normal;
+}
+
+/*
+* Finds the box positions are quantized against.
+* 
+* positions: vertex positions
+* offset: set to the center of their bounding box
+* scale: set to its half extents (never zero)
+*/
+void PackedVertex::ComputeBounds(const std::vector<glm::vec3>& positions,
+	glm::vec3& offset, glm::vec3& scale) {
+	glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+	for (const glm::vec3& p : positions) {
+		low = glm::min(low, p);
+		high = glm::max(high, p);
+	}
+
+	if (positions.empty()) low = high = glm::vec3(0.0f);
+
+	offset = 0.5f * (low + high);
+	scale = glm::max(0.5f * (high - low), glm::vec3(1e-6f));
+}
+
+/*
+* Packs every vertex into out, splitting the work across the shared
+* thread pool for large meshes.
+* 
+* positions, normals: per-vertex data, same length
+* offset, scale: bounding box from ComputeBounds
+* out: room for positions.size() vertices (e.g. a mapped GL buffer)
+*/
+void PackedVertex::Pack(const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals, const glm::vec3& offset, 
+	const glm::vec3& scale, PackedVertex* out) {
+	glm::vec3 invScale = 32767.0f / scale;
+
+	ThreadPool::Shared().ParallelFor((int)positions.size(), packGrain, 
+		[&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				glm::vec3 q = glm::round((positions[i] - offset) * invScale);
+				q = glm::clamp(q, glm::vec3(-32767.0f), glm::vec3(32767.0f));
+
+				PackedVertex& v = out[i];
+				v.position[0] = (GLshort)q.x;
+				v.position[1] = (GLshort)q.y;
+				v.position[2] = (GLshort)q.z;
+				v.position[3] = 0;
+				v.normal = PackNormal(normals[i]);
+			}
+		});
+}
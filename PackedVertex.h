@@ -0,0 +1,25 @@
+#pragma once
+
+#include "physics.h"
+
+/*
+* Compact 12 byte cloth vertex, half the size of a float position plus
+* float normal. The position is stored as signed normalized 16-bit
+* values relative to the mesh's bounding box (offset + value * scale),
+* the normal as a 10_10_10_2 signed normalized integer
+* (GL_INT_2_10_10_10_REV).
+*/
+struct PackedVertex
+{
+	GLshort position[4];	// x, y, z, padding
+	GLuint normal;
+
+	static GLuint PackNormal(const glm::vec3& normal);
+	static glm::vec3 UnpackNormal(GLuint packed);
+
+	static void ComputeBounds(const std::vector<glm::vec3>& positions, 
+		glm::vec3& offset, glm::vec3& scale);
+	static void Pack(const std::vector<glm::vec3>& positions, 
+		const std::vector<glm::vec3>& normals, const glm::vec3& offset, 
+		const glm::vec3& scale, PackedVertex* out);
+};
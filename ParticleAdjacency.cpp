@@ -0,0 +1,60 @@
+#include "ParticleAdjacency.h"
+
+/*
+* Builds the per-particle list of incident spring-dampers.
+* 
+* springs: constraint table the entries index into
+* numParticles: number of particles the table indexes into
+*/
+void ParticleAdjacency::BuildFromSprings(const std::vector<SpringDamper>& springs,
+	GLint numParticles) {
+	// count how many springs touch each particle
+	offsets.assign(numParticles + 1, 0);
+	for (const SpringDamper& sd : springs) {
+		offsets[sd.P1 + 1]++;
+		offsets[sd.P2 + 1]++;
+	}
+	CountsToOffsets(numParticles);
+
+	// fill every particle's slots in spring order
+	entries.resize(offsets[numParticles]);
+	std::vector<GLint> cursor(offsets.begin(), offsets.end() - 1);
+	for (GLint i = 0; i < (GLint)springs.size(); i++) {
+		entries[cursor[springs[i].P1]++] = (i << 1);
+		entries[cursor[springs[i].P2]++] = (i << 1) | 1;
+	}
+}
+
+/*
+* Builds the per-particle list of incident triangles.
+* 
+* triangles: triangle list the entries index into
+* numParticles: number of particles the triangles index into
+*/
+void ParticleAdjacency::BuildFromTriangles(const std::vector<Triangle*>& triangles,
+	GLint numParticles) {
+	offsets.assign(numParticles + 1, 0);
+	for (const Triangle* t : triangles) {
+		offsets[t->P1 + 1]++;
+		offsets[t->P2 + 1]++;
+		offsets[t->P3 + 1]++;
+	}
+	CountsToOffsets(numParticles);
+
+	entries.resize(offsets[numParticles]);
+	std::vector<GLint> cursor(offsets.begin(), offsets.end() - 1);
+	for (GLint i = 0; i < (GLint)triangles.size(); i++) {
+		entries[cursor[triangles[i]->P1]++] = i;
+		entries[cursor[triangles[i]->P2]++] = i;
+		entries[cursor[triangles[i]->P3]++] = i;
+	}
+}
+
+/*
+* Prefix sum turning per-particle counts (stored at p + 1) into offsets.
+*/
+void ParticleAdjacency::CountsToOffsets(GLint numParticles) {
+	for (GLint p = 0; p < numParticles; p++) {
+		offsets[p + 1] += offsets[p];
+	}
+}
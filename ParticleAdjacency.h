@@ -0,0 +1,31 @@
+#pragma once
+
+#include "SpringDamper.h"
+#include "Triangle.h"
+
+/*
+* Compressed sparse row (CSR) list of the constraints touching each
+* particle. The entries of particle p are entries[offsets[p]] up to
+* entries[offsets[p + 1]], so a particle can gather its own force
+* without anybody else writing to it.
+*/
+class ParticleAdjacency
+{
+public:
+	std::vector<GLint> offsets;
+	std::vector<GLint> entries;
+
+	// spring entries are (springIndex << 1) | side, where side is 1 when
+	// the particle is P2 and so receives the negated spring force
+	void BuildFromSprings(const std::vector<SpringDamper>& springs, 
+		GLint numParticles);
+	// triangle entries are plain triangle indices
+	void BuildFromTriangles(const std::vector<Triangle*>& triangles,
+		GLint numParticles);
+
+	GLint begin(GLint particle) const { return offsets[particle]; }
+	GLint end(GLint particle) const { return offsets[particle + 1]; }
+
+private:
+	void CountsToOffsets(GLint numParticles);
+};
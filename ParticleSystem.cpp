@@ -0,0 +1,76 @@
+#include "ParticleSystem.h"
+
+
+/*
+* Constructor. Starts out empty, particles are added with AddParticle.
+*/
+ParticleSystem::ParticleSystem() {
+
+}
+
+ParticleSystem::~ParticleSystem() {
+
+}
+
+/*
+* Appends a new particle at rest and returns its index.
+* 
+* position: given position to start at
+* mass: given mass constant
+*/
+GLint ParticleSystem::AddParticle(glm::vec3 position, GLfloat mass) {
+	GLint index = size();
+
+	positions.push_back(position);
+	velocities.push_back(glm::vec3(0.0f));
+	forces.push_back(glm::vec3(0.0f));
+	normals.push_back(glm::vec3(0.0f));
+	masses.push_back(mass);
+	inverseMasses.push_back(1.0f / mass);
+	pinned.push_back(0);
+
+	return index;
+}
+
+/*
+* Method that computes semi-implicit Euler integration on one particle.
+* Collisions are resolved separately afterwards (ColliderSet).
+* 
+* index: which particle to integrate
+* deltaTime: the size of the time step to take forward in time
+*/
+void ParticleSystem::Integrate(GLint index, GLfloat deltaTime) {
+	// fixed particles ignore whatever force was accumulated on them
+	if (pinned[index]) {
+		forces[index] = glm::vec3(0.0f);
+		return;
+	}
+
+	// compute acceleration from all forces added up already
+	glm::vec3 acceleration = inverseMasses[index] * forces[index];
+	// compute velocity at (i+1) from acceleration at i times a time step
+	velocities[index] += acceleration * deltaTime;
+	// compute position from velocity at (i+1) times a time step
+	positions[index] += velocities[index] * deltaTime;
+
+	//reset the forces of this particle
+	forces[index] = glm::vec3(0.0f);
+}
+
+/*
+* Call this method to make a particle fixed
+*/
+void ParticleSystem::Fixate(GLint index) {
+	pinned[index] = 1;
+}
+
+/*
+* Updates position of those fixed particles to move around cloth
+* 
+* index: which particle to move
+* distToMove: distance to move this particle
+*/
+void ParticleSystem::updateFixedPos(GLint index, glm::vec3 distToMove) {
+	positions[index] += distToMove;
+}
+
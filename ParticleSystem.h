@@ -0,0 +1,33 @@
+#pragma once
+
+#include "physics.h"
+
+/*
+* Contiguous structure-of-arrays store for every particle of a cloth.
+* Particles are referred to by their index into these arrays instead of
+* by pointer, so force and integration passes walk memory linearly.
+*/
+class ParticleSystem
+{
+public:
+	// per-particle state, all indexed by particle index
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> velocities;
+	std::vector<glm::vec3> forces;
+	std::vector<glm::vec3> normals;
+	std::vector<GLfloat> masses;
+	std::vector<GLfloat> inverseMasses;
+	std::vector<unsigned char> pinned;	// 1 if particle is fixed in place
+
+	ParticleSystem();
+	~ParticleSystem();
+
+	GLint AddParticle(glm::vec3 position, GLfloat mass);
+	GLint size() const { return (GLint)positions.size(); }
+
+	void ApplyForce(GLint index, const glm::vec3& f) { forces[index] += f; }
+	void Integrate(GLint index, GLfloat deltaTime);
+	void Fixate(GLint index);
+
+	void updateFixedPos(GLint index, glm::vec3 distToMove);
+};
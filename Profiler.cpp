@@ -0,0 +1,138 @@
+#include "Profiler.h"
+
+#include <cstdio>
+
+/*
+* Constructor. Starts enabled with an empty buffer.
+*/
+Profiler::Profiler() : enabled(true), head(0), historyFrames(0) {
+	this->start = std::chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < capacity; i++) {
+		events[i].sequence.store(0, std::memory_order_relaxed);
+	}
+	for (int p = 0; p < PHASE_COUNT; p++) {
+		frameTotals[p].store(0, std::memory_order_relaxed);
+		historySums[p] = 0;
+		averages[p] = 0.0f;
+	}
+	for (unsigned int f = 0; f < averageFrames; f++) {
+		for (int p = 0; p < PHASE_COUNT; p++) history[f][p] = 0;
+	}
+}
+
+Profiler& Profiler::Shared() {
+	static Profiler profiler;
+	return profiler;
+}
+
+/*
+* Nanoseconds since the profiler was created.
+*/
+long long Profiler::Now() const {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+/*
+* Stores one timed scope. Safe to call from any number of threads at once:
+* each call claims its own slot, oldest events get overwritten.
+* 
+* phase: what was timed
+* begin, end: from Now()
+*/
+void Profiler::Record(ProfilePhase phase, long long begin, long long end) {
+	// small stable id per thread for the trace viewer
+	static std::atomic<unsigned int> nextThread(0);
+	thread_local unsigned int thread = nextThread.fetch_add(1);
+
+	unsigned long long index = head.fetch_add(1, std::memory_order_relaxed);
+	Event& event = events[index & (capacity - 1)];
+
+	// mark the slot as being written, then publish it once complete
+	event.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	event.begin = begin;
+	event.end = end;
+	event.thread = thread;
+	event.phase = (unsigned char)phase;
+	event.sequence.store(index + 1, std::memory_order_release);
+
+	frameTotals[phase].fetch_add(end - begin, std::memory_order_relaxed);
+}
+
+/*
+* Closes the current frame: its per-phase totals replace the oldest frame
+* in the rolling window and averages is refreshed. Call once per frame
+* from the main loop.
+*/
+void Profiler::EndFrame() {
+	unsigned int slot = historyFrames % averageFrames;
+	historyFrames++;
+	unsigned int frames = historyFrames < averageFrames ? historyFrames : averageFrames;
+
+	for (int p = 0; p < PHASE_COUNT; p++) {
+		long long total = frameTotals[p].exchange(0, std::memory_order_relaxed);
+		historySums[p] += total - history[slot][p];
+		history[slot][p] = total;
+		averages[p] = (float)(historySums[p] / 1e6 / frames);
+	}
+}
+
+/*
+* Writes every event still in the ring buffer as a Chrome trace event
+* file, viewable in chrome://tracing or ui.perfetto.dev.
+* 
+* path: file to (over)write
+* returns: false if the file couldn't be written
+*/
+bool Profiler::WriteChromeTrace(const char* path) const {
+	FILE* file = fopen(path, "w");
+	if (!file) return false;
+
+	unsigned long long last = head.load(std::memory_order_acquire);
+	unsigned long long first = last > capacity ? last - capacity : 0;
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool firstEvent = true;
+	for (unsigned long long index = first; index < last; index++) {
+		const Event& event = events[index & (capacity - 1)];
+
+		// skip slots still being written or already overwritten
+		if (event.sequence.load(std::memory_order_acquire) != index + 1) continue;
+		long long begin = event.begin, end = event.end;
+		unsigned int thread = event.thread;
+		ProfilePhase phase = (ProfilePhase)event.phase;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (event.sequence.load(std::memory_order_relaxed) != index + 1) continue;
+
+		// complete events, timestamps in microseconds
+		fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			firstEvent ? "" : ",\n", PhaseName(phase), thread, begin / 1e3, (end - begin) / 1e3);
+		firstEvent = false;
+	}
+	fprintf(file, "\n]}\n");
+
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+const char* Profiler::PhaseName(ProfilePhase phase) {
+	switch (phase) {
+	case PHASE_FRAME: return "Frame";
+	case PHASE_SIMULATE: return "Simulate";
+	case PHASE_GRAVITY: return "Gravity";
+	case PHASE_SPRINGS: return "Springs";
+	case PHASE_AERO: return "Aero";
+	case PHASE_GATHER: return "Gather";
+	case PHASE_SOLVE: return "Solve";
+	case PHASE_INTEGRATE: return "Integrate";
+	case PHASE_COLLISION: return "Collision";
+	case PHASE_SELF_COLLISION: return "Self Collision";
+	case PHASE_NORMALS: return "Normals";
+	case PHASE_UPLOAD: return "Upload";
+	case PHASE_DRAW: return "Draw";
+	default: return "Unknown";
+	}
+}
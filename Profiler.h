@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+// the parts of a frame that get timed separately
+enum ProfilePhase {
+	PHASE_FRAME,		// a whole idle + display callback
+	PHASE_SIMULATE,		// every simulation step of the frame
+	PHASE_GRAVITY,
+	PHASE_SPRINGS,
+	PHASE_AERO,
+	PHASE_GATHER,		// summing gathered forces per particle
+	PHASE_SOLVE,		// implicit or XPBD solver steps
+	PHASE_INTEGRATE,
+	PHASE_COLLISION,
+	PHASE_SELF_COLLISION,
+	PHASE_NORMALS,
+	PHASE_UPLOAD,		// streaming positions/normals to the GPU
+	PHASE_DRAW,
+	PHASE_COUNT
+};
+
+/*
+* Collects timed scopes from any thread into a fixed size ring buffer
+* without locking, so recent frames can be written out as a Chrome trace
+* (chrome://tracing, Perfetto). Also keeps per-phase averages over the
+* last few frames for display.
+*/
+class Profiler
+{
+public:
+	// one timed scope, in nanoseconds since the profiler started
+	struct Event {
+		std::atomic<unsigned long long> sequence;	// slot index + 1 once written
+		long long begin, end;
+		unsigned int thread;
+		unsigned char phase;
+	};
+
+	static const unsigned int capacity = 1 << 16;	// power of two
+	static const unsigned int averageFrames = 64;
+
+	// nothing is recorded while this is false
+	std::atomic<bool> enabled;
+
+	// average milliseconds per frame spent in each phase
+	float averages[PHASE_COUNT];
+
+	Profiler();
+
+	long long Now() const;
+	void Record(ProfilePhase phase, long long begin, long long end);
+	void EndFrame();
+
+	bool WriteChromeTrace(const char* path) const;
+
+	static const char* PhaseName(ProfilePhase phase);
+
+	// profiler shared by the whole program
+	static Profiler& Shared();
+
+private:
+	std::chrono::steady_clock::time_point start;
+
+	Event events[capacity];
+	std::atomic<unsigned long long> head;
+
+	// nanoseconds spent in each phase since the last EndFrame
+	std::atomic<long long> frameTotals[PHASE_COUNT];
+
+	// per-frame totals of the last averageFrames frames and their sum
+	long long history[averageFrames][PHASE_COUNT];
+	long long historySums[PHASE_COUNT];
+	unsigned int historyFrames;
+};
+
+/*
+* Times the enclosing block as one phase:
+*	{ ProfileScope scope(PHASE_SPRINGS); ... }
+*/
+class ProfileScope
+{
+public:
+	ProfileScope(ProfilePhase phase) : phase(phase) {
+		Profiler& profiler = Profiler::Shared();
+		begin = profiler.enabled.load(std::memory_order_relaxed) ? profiler.Now() : -1;
+	}
+	~ProfileScope() {
+		if (begin < 0) return;
+		Profiler& profiler = Profiler::Shared();
+		profiler.Record(phase, begin, profiler.Now());
+	}
+
+private:
+	ProfilePhase phase;
+	long long begin;
+};
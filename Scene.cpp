@@ -0,0 +1,302 @@
+#include "Scene.h"
+
+#include "Tokenizer.h"
+
+#include <cctype>
+#include <cstring>
+
+// the cloth the viewer always started with
+Scene::ClothDesc::ClothDesc() {
+	this->length = 3.0f;
+	this->width = 3.0f;
+	this->particlesL = 30;
+	this->particlesW = 30;
+	this->topLeftPos = glm::vec3(-1.5f, 1.5f, 0.0f);
+	this->mass = 0.6f;
+	this->bending = ClothSimulation::defaultBending;
+	this->pinTop = true;
+}
+
+Scene::Scene() {
+	this->collidersReplaced = false;
+}
+
+static glm::vec3 GetVec3(Tokenizer& tokenizer) {
+	glm::vec3 v;
+	v.x = tokenizer.GetFloat();
+	v.y = tokenizer.GetFloat();
+	v.z = tokenizer.GetFloat();
+	return v;
+}
+
+/*
+* Reads a scene file, replacing whatever was loaded before.
+*
+* path: file to read
+* returns: false if it can't be read or has an error (printed with its
+* line number)
+*/
+bool Scene::Load(const char* path) {
+	cloths.clear();
+	settings.clear();
+	this->collidersReplaced = false;
+
+	Tokenizer tokenizer;
+	if (!tokenizer.Open(path)) return false;
+
+	bool inCloth = false;
+	char name[64];
+	for (;;) {
+		tokenizer.SkipWhitespace();
+		if (tokenizer.AtEnd()) break;
+		if (tokenizer.CheckChar() == '#') {
+			tokenizer.SkipLine();
+			continue;
+		}
+
+		tokenizer.GetToken(name, sizeof(name));
+		bool ok;
+		if (strcmp(name, "cloth") == 0) {
+			char brace[8];
+			tokenizer.GetToken(brace, sizeof(brace));
+			if (inCloth || strcmp(brace, "{") != 0) return tokenizer.Abort("expected 'cloth {' outside other cloths");
+			cloths.push_back(ClothDesc());
+			inCloth = true;
+			ok = true;
+		}
+		else if (strcmp(name, "}") == 0) {
+			if (!inCloth) return tokenizer.Abort("'}' without a cloth");
+			const ClothDesc& cloth = cloths.back();
+			for (size_t i = 0; i < cloth.pins.size(); i += 2) {
+				if (cloth.pins[i] >= cloth.particlesL || cloth.pins[i + 1] >= cloth.particlesW) {
+					return tokenizer.Abort("pinned particle outside the cloth");
+				}
+			}
+			inCloth = false;
+			ok = true;
+		}
+		else if (inCloth) {
+			ok = this->ReadCloth(tokenizer, name, cloths.back());
+		}
+		else {
+			ok = this->ReadSetting(tokenizer, name);
+		}
+
+		if (!ok) {
+			// every cloth shares one simulation, so settings can't differ
+			std::string error = std::string("unknown statement or bad value for '") + name + "'" +
+				(inCloth ? " (settings and colliders go outside cloth blocks)" : "");
+			return tokenizer.Abort(error.c_str());
+		}
+		if (tokenizer.GetErrorCount() > 0) return tokenizer.Abort("bad number");
+	}
+
+	if (inCloth) return tokenizer.Abort("missing '}'");
+	if (cloths.empty()) return tokenizer.Abort("no cloth in the scene");
+	tokenizer.Close();
+	return true;
+}
+
+/*
+* Reads a statement that only makes sense inside a cloth block.
+*
+* returns: false if name isn't one, or its values are out of range
+*/
+bool Scene::ReadCloth(Tokenizer& tokenizer, const char* name, ClothDesc& cloth) {
+	if (strcmp(name, "size") == 0) {
+		cloth.length = tokenizer.GetFloat();
+		cloth.width = tokenizer.GetFloat();
+		return cloth.length > 0.0f && cloth.width > 0.0f;
+	}
+	if (strcmp(name, "particles") == 0) {
+		cloth.particlesL = tokenizer.GetInt();
+		cloth.particlesW = tokenizer.GetInt();
+		return cloth.particlesL > 1 && cloth.particlesW > 1;
+	}
+	if (strcmp(name, "position") == 0) {
+		cloth.topLeftPos = GetVec3(tokenizer);
+		return true;
+	}
+	if (strcmp(name, "mass") == 0) {
+		cloth.mass = tokenizer.GetFloat();
+		return cloth.mass > 0.0f;
+	}
+	if (strcmp(name, "bending") == 0) {
+		cloth.bending = tokenizer.GetFloat();
+		return cloth.bending >= 0.0f;
+	}
+	if (strcmp(name, "pin") == 0) {
+		// pin top | pin none | pin ROW COLUMN
+		tokenizer.SkipWhitespace();
+		if (isdigit((unsigned char)tokenizer.CheckChar())) {
+			GLint row = tokenizer.GetInt(), column = tokenizer.GetInt();
+			cloth.pins.push_back(row);
+			cloth.pins.push_back(column);
+			return row >= 0 && column >= 0;
+		}
+
+		char which[16];
+		tokenizer.GetToken(which, sizeof(which));
+		if (strcmp(which, "top") == 0) cloth.pinTop = true;
+		else if (strcmp(which, "none") == 0) {
+			cloth.pinTop = false;
+			cloth.pins.clear();
+		}
+		else return false;
+		return true;
+	}
+	return false;
+}
+
+/*
+* Reads a setting or collider statement into settings.
+*
+* returns: false if name isn't one, or its values are out of range
+*/
+bool Scene::ReadSetting(Tokenizer& tokenizer, const char* name) {
+	if (strcmp(name, "wind") == 0) {
+		glm::vec3 wind = GetVec3(tokenizer);
+		settings.push_back([wind](ClothSimulation& s) { s.airVelocity = wind; });
+		return true;
+	}
+	if (strcmp(name, "integrator") == 0) {
+		char value[16];
+		tokenizer.GetToken(value, sizeof(value));
+		Integrator integrator;
+		if (strcmp(value, "explicit") == 0) integrator = INTEGRATOR_EXPLICIT;
+		else if (strcmp(value, "implicit") == 0) integrator = INTEGRATOR_IMPLICIT;
+		else if (strcmp(value, "xpbd") == 0) integrator = INTEGRATOR_XPBD;
+		else return false;
+		settings.push_back([integrator](ClothSimulation& s) { s.integrator = integrator; });
+		return true;
+	}
+	if (strcmp(name, "force") == 0) {
+		char value[16];
+		tokenizer.GetToken(value, sizeof(value));
+		ForceMode mode;
+		if (strcmp(value, "serial") == 0) mode = FORCE_SERIAL;
+		else if (strcmp(value, "colored") == 0) mode = FORCE_COLORED;
+		else if (strcmp(value, "gather") == 0) mode = FORCE_GATHER;
+		else return false;
+		settings.push_back([mode](ClothSimulation& s) { s.forceMode = mode; });
+		return true;
+	}
+	if (strcmp(name, "implicitsteps") == 0) {
+		GLint steps = tokenizer.GetInt();
+		settings.push_back([steps](ClothSimulation& s) { s.implicitSubsteps = steps; });
+		return steps > 0;
+	}
+	if (strcmp(name, "xpbdsteps") == 0) {
+		GLint steps = tokenizer.GetInt();
+		settings.push_back([steps](ClothSimulation& s) { s.xpbdSubsteps = steps; });
+		return steps > 0;
+	}
+	if (strcmp(name, "xpbditerations") == 0) {
+		GLint iterations = tokenizer.GetInt();
+		settings.push_back([iterations](ClothSimulation& s) { s.xpbdSolver.iterations = iterations; });
+		return iterations > 0;
+	}
+	if (strcmp(name, "safety") == 0) {
+		GLfloat safety = tokenizer.GetFloat();
+		settings.push_back([safety](ClothSimulation& s) { s.scheduler.safetyFactor = safety; });
+		return safety > 0.0f && safety <= 1.0f;
+	}
+	if (strcmp(name, "selfcollision") == 0) {
+		char value[16];
+		tokenizer.GetToken(value, sizeof(value));
+		bool enabled = strcmp(value, "on") == 0;
+		if (!enabled && strcmp(value, "off") != 0) return false;
+		settings.push_back([enabled](ClothSimulation& s) { s.selfCollision.enabled = enabled; });
+		return true;
+	}
+	if (strcmp(name, "thickness") == 0) {
+		GLfloat thickness = tokenizer.GetFloat();
+		settings.push_back([thickness](ClothSimulation& s) { s.selfCollision.thickness = thickness; });
+		return thickness > 0.0f;
+	}
+	if (strcmp(name, "restitution") == 0) {
+		GLfloat restitution = tokenizer.GetFloat();
+		settings.push_back([restitution](ClothSimulation& s) { s.colliders.restitution = restitution; });
+		return restitution >= 0.0f && restitution <= 1.0f;
+	}
+	if (strcmp(name, "friction") == 0) {
+		GLfloat friction = tokenizer.GetFloat();
+		settings.push_back([friction](ClothSimulation& s) { s.colliders.friction = friction; });
+		return friction >= 0.0f;
+	}
+
+	// colliders
+	Setting add;
+	if (strcmp(name, "plane") == 0) {
+		glm::vec3 point = GetVec3(tokenizer), normal = GetVec3(tokenizer);
+		if (!(glm::length(normal) > 0.0f)) return false;
+		add = [point, normal](ClothSimulation& s) { s.colliders.AddPlane(point, normal); };
+	}
+	else if (strcmp(name, "sphere") == 0) {
+		glm::vec3 center = GetVec3(tokenizer);
+		GLfloat radius = tokenizer.GetFloat();
+		if (!(radius > 0.0f)) return false;
+		add = [center, radius](ClothSimulation& s) { s.colliders.AddSphere(center, radius); };
+	}
+	else if (strcmp(name, "capsule") == 0) {
+		glm::vec3 a = GetVec3(tokenizer), b = GetVec3(tokenizer);
+		GLfloat radius = tokenizer.GetFloat();
+		if (!(radius > 0.0f)) return false;
+		add = [a, b, radius](ClothSimulation& s) { s.colliders.AddCapsule(a, b, radius); };
+	}
+	else if (strcmp(name, "box") == 0) {
+		glm::vec3 center = GetVec3(tokenizer), halfExtents = GetVec3(tokenizer);
+		if (!(glm::min(glm::min(halfExtents.x, halfExtents.y), halfExtents.z) > 0.0f)) return false;
+		add = [center, halfExtents](ClothSimulation& s) { s.colliders.AddBox(center, halfExtents); };
+	}
+	else {
+		return false;
+	}
+
+	// the scene's colliders take the place of the default ground plane
+	if (!collidersReplaced) {
+		settings.push_back([](ClothSimulation& s) { s.colliders.Clear(); });
+		this->collidersReplaced = true;
+	}
+	settings.push_back(add);
+	return true;
+}
+
+/*
+* Builds the scene's cloths in a new simulation.
+*
+* returns: the new simulation, the caller deletes it
+*/
+ClothSimulation* Scene::CreateSimulation() const {
+	ClothSimulation* simulation = new ClothSimulation();
+	this->Build(*simulation);
+	return simulation;
+}
+
+/*
+* Adds the scene's cloths to a simulation, pins their particles and gives
+* it the scene's settings and colliders.
+*
+* simulation: freshly built with no cloth, not stepping yet
+*/
+void Scene::Build(ClothSimulation& simulation) const {
+	ParticleSystem& particles = simulation.particles;
+	for (const ClothDesc& cloth : cloths) {
+		GLint index = simulation.AddCloth(cloth.length, cloth.width, cloth.particlesL,
+			cloth.particlesW, cloth.topLeftPos, cloth.mass, 0.0f, cloth.bending);
+
+		// AddCloth pins the top row
+		GLint first = simulation.getCloths()[index].firstParticle;
+		if (!cloth.pinTop) {
+			for (GLint column = 0; column < cloth.particlesW; column++) particles.pinned[first + column] = 0;
+		}
+		for (size_t i = 0; i < cloth.pins.size(); i += 2) {
+			particles.Fixate(first + cloth.pins[i] * cloth.particlesW + cloth.pins[i + 1]);
+		}
+	}
+
+	// free particles set the stable step
+	simulation.BuildTables();
+
+	for (const Setting& setting : settings) setting(simulation);
+}
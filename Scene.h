@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ClothSimulation.h"
+
+#include <functional>
+
+class Tokenizer;
+
+/*
+* Scene description read from a text file: the cloths to build, which of
+* their particles are pinned, and the settings and analytic colliders to
+* give them, so trying another setup needs no rebuild. All the cloths are
+* built into one ClothSimulation and stepped together. For example
+*
+*	# comments run to the end of the line
+*	wind 0.5 0 1
+*	integrator xpbd
+*	plane 0 -4.5 0  0 1 0
+*	cloth {
+*		size 3 3
+*		particles 30 30
+*		position -1.5 1.5 0
+*		mass 0.6
+*		bending 0.25
+*		pin top
+*	}
+*
+* Settings and colliders go at the top level and apply to every cloth;
+* a cloth block only holds its layout and pins. Anything not mentioned
+* keeps ClothSimulation's default, except that the first collider
+* mentioned replaces the default ground plane. scenes/default.scene lists
+* every statement.
+*/
+class Scene
+{
+public:
+	typedef std::function<void(ClothSimulation&)> Setting;
+
+	// one cloth to build, from the ClothSimulation constructor's arguments
+	struct ClothDesc {
+		GLfloat length, width;
+		GLint particlesL, particlesW;
+		glm::vec3 topLeftPos;
+		GLfloat mass;
+		GLfloat bending;			// 0 for no bending springs
+
+		bool pinTop;				// pin the first row, as the constructor does
+		std::vector<GLint> pins;	// row, column of each particle to pin besides
+
+		ClothDesc();
+	};
+
+	std::vector<ClothDesc> cloths;
+
+	Scene();
+
+	bool Load(const char* path);
+
+	ClothSimulation* CreateSimulation() const;
+	void Build(ClothSimulation& simulation) const;
+
+private:
+	std::vector<Setting> settings;
+	bool collidersReplaced;
+
+	bool ReadSetting(Tokenizer& tokenizer, const char* name);
+	bool ReadCloth(Tokenizer& tokenizer, const char* name, ClothDesc& cloth);
+};
@@ -0,0 +1,195 @@
+#include "SelfCollision.h"
+
+#include "ThreadPool.h"
+
+#include <cmath>
+
+// smallest number of particles worth handing to another thread
+static const GLint collisionGrain = 512;
+
+/*
+* Closest point to p on triangle abc (Ericson, Real-Time Collision
+* Detection 5.1.5).
+*/
+static glm::vec3 ClosestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, 
+	const glm::vec3& b, const glm::vec3& c) {
+	glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+	GLfloat d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+	glm::vec3 bp = p - b;
+	GLfloat d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return b;
+
+	GLfloat vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+	glm::vec3 cp = p - c;
+	GLfloat d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return c;
+
+	GLfloat vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+	GLfloat va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	GLfloat denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+SelfCollision::SelfCollision() {
+	this->enabled = true;
+	this->thickness = 0.0f;
+	this->restExclusion = 0.0f;
+	this->lastContacts = 0;
+}
+
+/*
+* Remembers the rest shape and picks a thickness to match the particle
+* spacing. Call once the particles are in their rest positions.
+* 
+* particles: store the cloth starts out as
+* clothOf: index of the cloth each particle belongs to
+* minRestLength: shortest spring rest length
+*/
+void SelfCollision::Initialize(const ParticleSystem& particles, const std::vector<GLint>& clothOf, 
+	GLfloat minRestLength) {
+	restPositions = particles.positions;
+	this->clothOf = clothOf;
+
+	// half the spacing, and skip everything up to the diagonal neighbours
+	this->thickness = 0.5f * minRestLength;
+	this->restExclusion = 1.5f * minRestLength;
+}
+
+bool SelfCollision::IsRestNeighbor(GLint p, GLint q) const {
+	// rest shapes of different cloths say nothing about each other
+	if (clothOf[p] != clothOf[q]) return false;
+
+	glm::vec3 d = restPositions[p] - restPositions[q];
+	return glm::dot(d, d) < restExclusion * restExclusion;
+}
+
+/*
+* Pushes apart every particle-particle and particle-triangle pair closer
+* than thickness. Corrections of all particles are found first and
+* applied afterwards (Jacobi), so the result doesn't depend on order.
+* 
+* particles: store to fix up, right after integration
+* triangles: surface of the cloth
+*/
+void SelfCollision::Resolve(ParticleSystem& particles, const std::vector<Triangle*>& triangles) {
+	ThreadPool& pool = ThreadPool::Shared();
+	GLint numParticles = particles.size();
+	GLint numTriangles = (GLint)triangles.size();
+	if (numParticles == 0 || thickness <= 0.0f) return;
+
+	// triangle bounds grown by thickness, so any triangle a point can
+	// touch has the point inside its box. Cells as big as a grown triangle
+	// at rest hold most triangles in a single cell.
+	triangleLows.resize(numTriangles);
+	triangleHighs.resize(numTriangles);
+	pool.ParallelFor(numTriangles, collisionGrain, [&](int begin, int end) {
+		for (GLint t = begin; t < end; t++) {
+			const glm::vec3& a = particles.positions[triangles[t]->P1];
+			const glm::vec3& b = particles.positions[triangles[t]->P2];
+			const glm::vec3& c = particles.positions[triangles[t]->P3];
+			triangleLows[t] = glm::min(a, glm::min(b, c)) - glm::vec3(thickness);
+			triangleHighs[t] = glm::max(a, glm::max(b, c)) + glm::vec3(thickness);
+		}
+	});
+
+	particleHash.Build(particles.positions, thickness);
+	triangleHash.BuildFromBoxes(triangleLows, triangleHighs, 4.0f * thickness);
+
+	positionCorrections.resize(numParticles);
+	velocityCorrections.resize(numParticles);
+	contacts.resize(numParticles);
+
+	pool.ParallelFor(numParticles, collisionGrain, [&](int begin, int end) {
+		for (GLint p = begin; p < end; p++) {
+			glm::vec3 dx(0.0f), dv(0.0f);
+			GLint found = 0;
+
+			// pinned particles stay put, and one that blew up has nothing
+			// sensible to collide with
+			const glm::vec3& position = particles.positions[p];
+			if (particles.pinned[p] || !std::isfinite(glm::dot(position, position))) {
+				positionCorrections[p] = dx;
+				velocityCorrections[p] = dv;
+				contacts[p] = 0;
+				continue;
+			}
+
+			const glm::vec3& velocity = particles.velocities[p];
+			GLfloat weight = particles.inverseMasses[p];
+
+			// particle-particle, each pair's share by inverse mass
+			particleHash.Query(position, [&](GLint q) {
+				glm::vec3 d = position - particles.positions[q];
+				GLfloat distSq = glm::dot(d, d);
+				if (!(distSq > 0.0f && distSq < thickness * thickness)) return;
+				if (this->IsRestNeighbor(p, q)) return;
+
+				GLfloat dist = glm::sqrt(distSq);
+				glm::vec3 n = d / dist;
+				GLfloat otherWeight = particles.pinned[q] ? 0.0f : particles.inverseMasses[q];
+				GLfloat share = weight / (weight + otherWeight);
+
+				dx += share * (thickness - dist) * n;
+				GLfloat approach = glm::dot(velocity - particles.velocities[q], n);
+				if (approach < 0.0f) dv -= share * approach * n;
+				found++;
+			});
+
+			// particle-triangle, only the particle moves
+			triangleHash.QueryBoxes(position, [&](GLint t) {
+				const glm::vec3& low = triangleLows[t];
+				const glm::vec3& high = triangleHighs[t];
+				if (!(position.x >= low.x && position.y >= low.y && position.z >= low.z &&
+					position.x <= high.x && position.y <= high.y && position.z <= high.z)) return;
+
+				const Triangle* triangle = triangles[t];
+				GLint a = triangle->P1, b = triangle->P2, c = triangle->P3;
+				if (a == p || b == p || c == p) return;
+				if (this->IsRestNeighbor(p, a) || this->IsRestNeighbor(p, b) ||
+					this->IsRestNeighbor(p, c)) return;
+
+				glm::vec3 closest = ClosestPointOnTriangle(position, 
+					particles.positions[a], particles.positions[b], particles.positions[c]);
+				glm::vec3 d = position - closest;
+				GLfloat distSq = glm::dot(d, d);
+				if (!(distSq > 0.0f && distSq < thickness * thickness)) return;
+
+				GLfloat dist = glm::sqrt(distSq);
+				glm::vec3 n = d / dist;
+				glm::vec3 surfaceVelocity = (particles.velocities[a] + 
+					particles.velocities[b] + particles.velocities[c]) / 3.0f;
+
+				dx += (thickness - dist) * n;
+				GLfloat approach = glm::dot(velocity - surfaceVelocity, n);
+				if (approach < 0.0f) dv -= approach * n;
+				found++;
+			});
+
+			positionCorrections[p] = dx;
+			velocityCorrections[p] = dv;
+			contacts[p] = found;
+		}
+	});
+
+	GLint total = 0;
+	for (GLint p = 0; p < numParticles; p++) {
+		if (!contacts[p]) continue;
+
+		// average so many contacts at once don't overshoot
+		GLfloat scale = 1.0f / contacts[p];
+		particles.positions[p] += scale * positionCorrections[p];
+		particles.velocities[p] += scale * velocityCorrections[p];
+		total += contacts[p];
+	}
+	this->lastContacts = total;
+}
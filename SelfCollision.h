@@ -0,0 +1,47 @@
+#pragma once
+
+#include "SpatialHash.h"
+#include "Triangle.h"
+
+/*
+* Keeps a cloth from passing through itself. Every call hashes the
+* particles and the triangle bounds into uniform grids, then each
+* particle looks up the particles and triangles near it and is pushed out
+* to at least thickness away from them, with the approaching part of its
+* velocity removed. Each particle only writes its own correction, so the
+* lookups run in parallel with no locking.
+* 
+* Particles that are close together in the rest shape (direct and
+* diagonal neighbours, the triangles around them) are never tested
+* against each other, they are kept apart by the springs. That only holds
+* within one cloth: particles of different cloths always collide.
+*/
+class SelfCollision
+{
+public:
+	bool enabled;
+	GLfloat thickness;		// smallest allowed distance between surfaces
+	GLfloat restExclusion;	// pairs closer than this at rest are skipped
+
+	GLint lastContacts;		// contacts resolved by the last call
+
+	SelfCollision();
+
+	void Initialize(const ParticleSystem& particles, const std::vector<GLint>& clothOf, 
+		GLfloat minRestLength);
+	void Resolve(ParticleSystem& particles, const std::vector<Triangle*>& triangles);
+
+private:
+	std::vector<glm::vec3> restPositions;
+	std::vector<GLint> clothOf;		// cloth each particle belongs to
+
+	SpatialHash particleHash, triangleHash;
+	std::vector<glm::vec3> triangleLows, triangleHighs;
+
+	// per-particle results of the parallel lookup
+	std::vector<glm::vec3> positionCorrections;
+	std::vector<glm::vec3> velocityCorrections;
+	std::vector<GLint> contacts;
+
+	bool IsRestNeighbor(GLint p, GLint q) const;
+};
@@ -0,0 +1,147 @@
+#include "SimulationThread.h"
+
+#include "Profiler.h"
+
+#include <chrono>
+
+/*
+* Constructor. The thread doesn't run until Start.
+* 
+* simulation: cloth to step, must outlive this
+*/
+SimulationThread::SimulationThread(ClothSimulation& simulation) : 
+	simulation(simulation), stopping(false), back(0), front(1), middle(2) {
+
+}
+
+SimulationThread::~SimulationThread() {
+	this->Stop();
+}
+
+double SimulationThread::Now() {
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+* Publishes the current state so Acquire has something to return, then
+* hands the simulation over to the new thread.
+*/
+void SimulationThread::Start() {
+	if (isRunning()) return;
+
+	Snapshot& snapshot = slots[back];
+	snapshot.previousPositions = simulation.particles.positions;
+	snapshot.positions = simulation.particles.positions;
+	snapshot.normals = simulation.particles.normals;
+	snapshot.time = Now();
+	snapshot.frame = 0;
+	snapshot.substeps = simulation.lastSubsteps;
+	snapshot.contacts = simulation.selfCollision.lastContacts;
+	this->Publish();
+
+	stopping = false;
+	thread = std::thread(&SimulationThread::Run, this);
+}
+
+/*
+* Waits for the current frame step to finish and gives the simulation
+* back to the calling thread. Commands still queued are run first.
+*/
+void SimulationThread::Stop() {
+	if (!isRunning()) return;
+
+	stopping = true;
+	thread.join();
+
+	std::lock_guard<std::mutex> lock(commandMutex);
+	for (const std::function<void(ClothSimulation&)>& command : commands) {
+		command(simulation);
+	}
+	commands.clear();
+}
+
+/*
+* Queues a change to the simulation (moving the pinned particles, etc.)
+* to run on the simulation thread between frame steps.
+*/
+void SimulationThread::Post(const std::function<void(ClothSimulation&)>& command) {
+	std::lock_guard<std::mutex> lock(commandMutex);
+	commands.push_back(command);
+}
+
+/*
+* Returns the newest published snapshot. It stays untouched until the
+* next call to Acquire, no matter how far the simulation gets meanwhile.
+* Only one thread may call this.
+*/
+const SimulationThread::Snapshot& SimulationThread::Acquire() {
+	if (middle.load(std::memory_order_relaxed) & fresh) {
+		front = middle.exchange(front, std::memory_order_acq_rel) & ~fresh;
+	}
+	return slots[front];
+}
+
+/*
+* How far to blend from previousPositions to positions. Drawing runs one
+* frame step behind the simulation, so a snapshot that was just finished
+* is shown at its previous state and reaches its own state one step
+* later.
+* 
+* snapshot: from Acquire
+* now: from Now()
+*/
+GLfloat SimulationThread::getAlpha(const Snapshot& snapshot, double now) const {
+	GLfloat alpha = (GLfloat)((now - snapshot.time) / simulation.scheduler.fixedTimeStep);
+	return glm::clamp(alpha, 0.0f, 1.0f);
+}
+
+/*
+* Swaps the filled back slot into the middle for the reader to pick up.
+*/
+void SimulationThread::Publish() {
+	back = middle.exchange(back | fresh, std::memory_order_acq_rel) & ~fresh;
+}
+
+void SimulationThread::Run() {
+	double lastTime = Now();
+	long long frame = 0;
+	std::vector<std::function<void(ClothSimulation&)> > pending;
+
+	while (!stopping) {
+		{
+			std::lock_guard<std::mutex> lock(commandMutex);
+			pending.swap(commands);
+		}
+		for (const std::function<void(ClothSimulation&)>& command : pending) {
+			command(simulation);
+		}
+		pending.clear();
+
+		double currentTime = Now();
+		GLint steps = simulation.scheduler.Advance((GLfloat)(currentTime - lastTime));
+		lastTime = currentTime;
+
+		for (GLint i = 0; i < steps; i++) {
+			ProfileScope scope(PHASE_SIMULATE);
+
+			Snapshot& snapshot = slots[back];
+			snapshot.previousPositions = simulation.particles.positions;
+			simulation.Update();
+			snapshot.positions = simulation.particles.positions;
+			snapshot.normals = simulation.particles.normals;
+			snapshot.time = Now();
+			snapshot.frame = ++frame;
+			snapshot.substeps = simulation.lastSubsteps;
+			snapshot.contacts = simulation.selfCollision.lastContacts;
+
+			this->Publish();
+		}
+
+		// nothing due yet, sleep until the next frame step is
+		if (steps == 0) {
+			GLfloat remaining = (1.0f - simulation.scheduler.getAlpha()) * simulation.scheduler.fixedTimeStep;
+			std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+		}
+	}
+}
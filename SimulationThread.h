@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ClothSimulation.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/*
+* Runs a ClothSimulation on its own thread at the scheduler's fixed time
+* step, so rendering and simulation don't wait on each other. After every
+* frame step the particle state is published into a lock-free triple
+* buffer; the render thread picks up the newest complete snapshot with
+* Acquire and interpolates between the two states it holds.
+* 
+* While the thread runs it owns the simulation: other threads change it
+* only through Post.
+*/
+class SimulationThread
+{
+public:
+	// particle state after one frame step, plus the one before it
+	struct Snapshot {
+		std::vector<glm::vec3> previousPositions;
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		double time;			// Now() when the step finished
+		long long frame;		// frame steps simulated so far
+		GLint substeps;			// lastSubsteps of the step
+		GLint contacts;			// self-collision contacts it resolved
+	};
+
+	SimulationThread(ClothSimulation& simulation);
+	~SimulationThread();
+
+	void Start();
+	void Stop();
+	bool isRunning() const { return thread.joinable(); }
+
+	void Post(const std::function<void(ClothSimulation&)>& command);
+
+	const Snapshot& Acquire();
+	GLfloat getAlpha(const Snapshot& snapshot, double now) const;
+
+	// seconds on the clock snapshots are stamped with
+	static double Now();
+
+private:
+	ClothSimulation& simulation;
+
+	std::thread thread;
+	std::atomic<bool> stopping;
+
+	// commands from other threads, run before the next frame step
+	std::mutex commandMutex;
+	std::vector<std::function<void(ClothSimulation&)> > commands;
+
+	// triple buffer: the writer fills back, the reader holds front, and
+	// middle is swapped with either (fresh flag set when the writer swaps)
+	static const int fresh = 4;
+	Snapshot slots[3];
+	int back, front;
+	std::atomic<int> middle;
+
+	void Run();
+	void Publish();
+};
@@ -0,0 +1,271 @@
+#include "Snapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+// arrays are copied in and out of the file as raw bytes
+static_assert(std::is_trivially_copyable<ClothLayout>::value, "ClothLayout must be plain data");
+static_assert(std::is_trivially_copyable<SpringDamper>::value, "SpringDamper must be plain data");
+static_assert(std::is_trivially_copyable<ColliderSet::Box>::value, "collider shapes must be plain data");
+
+static const char magic[8] = { 'C', 'L', 'T', 'H', 'S', 'N', 'A', 'P' };
+static const unsigned int byteOrderMark = 0x01020304;
+
+// every array starts on a boundary this size
+static const unsigned long long sectionAlignment = 16;
+
+// bytes per entry of each section
+static const size_t elementSizes[Snapshot::SECTION_COUNT] = {
+	sizeof(ClothLayout),
+	sizeof(glm::vec3),				// positions
+	sizeof(glm::vec3),				// velocities
+	sizeof(GLfloat),				// masses
+	sizeof(GLfloat),				// inverse masses
+	sizeof(unsigned char),			// pinned
+	sizeof(SpringDamper),
+	sizeof(ColliderSet::Plane),
+	sizeof(ColliderSet::Sphere),
+	sizeof(ColliderSet::Capsule),
+	sizeof(ColliderSet::Box)
+};
+
+static unsigned long long Align(unsigned long long offset) {
+	return (offset + sectionAlignment - 1) & ~(sectionAlignment - 1);
+}
+
+/*
+* Saves a simulation's state. Must not run while the simulation steps (on
+* a SimulationThread, Post it).
+*
+* simulation: cloth to save
+* frame: frame count to store alongside, for resuming
+* path: file to (over)write
+* returns: false if the file couldn't be written; an older file at path is
+* then left as it was
+*/
+bool Snapshot::Write(const ClothSimulation& simulation, GLint frame, const std::string& path) {
+	const ParticleSystem& particles = simulation.particles;
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.byteOrder = byteOrderMark;
+	header.frame = frame;
+
+	header.integrator = simulation.integrator;
+	header.forceMode = simulation.forceMode;
+	header.implicitSubsteps = simulation.implicitSubsteps;
+	header.xpbdSubsteps = simulation.xpbdSubsteps;
+	header.xpbdIterations = simulation.xpbdSolver.iterations;
+	header.airVelocity[0] = simulation.airVelocity.x;
+	header.airVelocity[1] = simulation.airVelocity.y;
+	header.airVelocity[2] = simulation.airVelocity.z;
+	header.safetyFactor = simulation.scheduler.safetyFactor;
+	header.selfCollisionEnabled = simulation.selfCollision.enabled ? 1 : 0;
+	header.selfCollisionThickness = simulation.selfCollision.thickness;
+	header.restitution = simulation.colliders.restitution;
+	header.friction = simulation.colliders.friction;
+
+	const void* sources[SECTION_COUNT] = {
+		simulation.cloths.data(),
+		particles.positions.data(),
+		particles.velocities.data(),
+		particles.masses.data(),
+		particles.inverseMasses.data(),
+		particles.pinned.data(),
+		simulation.springDampers.data(),
+		simulation.colliders.planes.data(),
+		simulation.colliders.spheres.data(),
+		simulation.colliders.capsules.data(),
+		simulation.colliders.boxes.data()
+	};
+	GLint numParticles = particles.size();
+	GLint counts[SECTION_COUNT] = {
+		(GLint)simulation.cloths.size(),
+		numParticles, numParticles, numParticles, numParticles, numParticles,
+		(GLint)simulation.springDampers.size(),
+		(GLint)simulation.colliders.planes.size(),
+		(GLint)simulation.colliders.spheres.size(),
+		(GLint)simulation.colliders.capsules.size(),
+		(GLint)simulation.colliders.boxes.size()
+	};
+
+	unsigned long long offset = Align(sizeof(Header));
+	for (int s = 0; s < SECTION_COUNT; s++) {
+		header.counts[s] = counts[s];
+		header.offsets[s] = offset;
+		offset = Align(offset + (unsigned long long)counts[s] * elementSizes[s]);
+	}
+	header.fileSize = offset;
+
+	std::string temporaryPath = path + ".tmp";
+	FILE* out = fopen(temporaryPath.c_str(), "wb");
+	if (!out) return false;
+
+	// zeros up to the start of each array
+	static const char padding[sectionAlignment] = {};
+	unsigned long long position = sizeof(Header);
+	bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+	for (int s = 0; s < SECTION_COUNT && ok; s++) {
+		size_t gap = (size_t)(header.offsets[s] - position);
+		size_t bytes = counts[s] * elementSizes[s];
+		ok = (gap == 0 || fwrite(padding, gap, 1, out) == 1) &&
+			(bytes == 0 || fwrite(sources[s], bytes, 1, out) == 1);
+		position = header.offsets[s] + bytes;
+	}
+	size_t gap = (size_t)(header.fileSize - position);
+	ok = ok && (gap == 0 || fwrite(padding, gap, 1, out) == 1);
+	ok = fclose(out) == 0 && ok;
+	if (!ok) {
+		remove(temporaryPath.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	// rename doesn't replace existing files here
+	remove(path.c_str());
+#endif
+	return rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+/*
+* Maps a snapshot file and checks that its header and arrays make sense.
+*
+* path: file written by Write
+* returns: false if it can't be read here; the snapshot is closed then
+*/
+bool Snapshot::Open(const std::string& path) {
+	if (!file.Open(path)) return false;
+
+	bool ok = file.size() >= sizeof(Header);
+	if (ok) {
+		const Header& header = this->getHeader();
+		ok = memcmp(header.magic, magic, sizeof(magic)) == 0 &&
+			header.version == version && header.byteOrder == byteOrderMark &&
+			header.fileSize == file.size() &&
+			header.integrator >= INTEGRATOR_EXPLICIT && header.integrator <= INTEGRATOR_XPBD &&
+			header.forceMode >= FORCE_SERIAL && header.forceMode <= FORCE_GATHER;
+
+		// arrays must lie within the file, aligned, and the particle ones
+		// must all be as long as the cloths are large together
+		for (int s = 0; s < SECTION_COUNT && ok; s++) {
+			unsigned long long end = header.offsets[s] + (unsigned long long)header.counts[s] * elementSizes[s];
+			ok = header.counts[s] >= 0 && header.offsets[s] >= sizeof(Header) &&
+				header.offsets[s] % sectionAlignment == 0 && end <= header.fileSize;
+		}
+		long long numParticles = 0;
+		for (GLint c = 0; c < header.counts[SECTION_CLOTHS] && ok; c++) {
+			const ClothLayout& cloth = this->Array<ClothLayout>(SECTION_CLOTHS)[c];
+			ok = cloth.particlesL > 1 && cloth.particlesW > 1;
+			numParticles += (long long)cloth.particlesL * cloth.particlesW;
+		}
+		ok = ok && header.counts[SECTION_CLOTHS] > 0;
+		for (int s = SECTION_POSITIONS; s <= SECTION_PINNED && ok; s++) {
+			ok = header.counts[s] == numParticles;
+		}
+	}
+
+	if (!ok) file.Close();
+	return ok;
+}
+
+void Snapshot::Close() {
+	file.Close();
+}
+
+/*
+* Puts an open snapshot's state into a simulation laid out the same way,
+* best one fresh from its constructor (see CreateSimulation). Must not run
+* while the simulation steps.
+*
+* simulation: cloth to overwrite
+* returns: false, leaving the simulation as it was, if its particles or
+* springs don't match the snapshot's
+*/
+bool Snapshot::Restore(ClothSimulation& simulation) const {
+	const Header& header = this->getHeader();
+	ParticleSystem& particles = simulation.particles;
+
+	// same particles, connected by the same springs in the same order
+	GLint numParticles = header.counts[SECTION_POSITIONS];
+	GLint numSprings = header.counts[SECTION_SPRINGS];
+	if (numParticles != particles.size() || numSprings != (GLint)simulation.springDampers.size()) {
+		return false;
+	}
+	const SpringDamper* springs = this->Array<SpringDamper>(SECTION_SPRINGS);
+	for (GLint i = 0; i < numSprings; i++) {
+		const SpringDamper& current = simulation.springDampers[i];
+		if (springs[i].P1 != current.P1 || springs[i].P2 != current.P2) return false;
+	}
+
+	const glm::vec3* positions = this->Array<glm::vec3>(SECTION_POSITIONS);
+	const glm::vec3* velocities = this->Array<glm::vec3>(SECTION_VELOCITIES);
+	const GLfloat* masses = this->Array<GLfloat>(SECTION_MASSES);
+	const GLfloat* inverseMasses = this->Array<GLfloat>(SECTION_INVERSE_MASSES);
+	const unsigned char* pinned = this->Array<unsigned char>(SECTION_PINNED);
+	particles.masses.assign(masses, masses + numParticles);
+	particles.inverseMasses.assign(inverseMasses, inverseMasses + numParticles);
+	particles.pinned.assign(pinned, pinned + numParticles);
+
+	// constants may have been tuned since the cloth was built; the limits
+	// are estimated in the pose the simulation is in now, as its
+	// constructor did, so a restored cloth takes the same substeps
+	simulation.springDampers.assign(springs, springs + numSprings);
+	simulation.springKernel.Build(simulation.springDampers);
+	simulation.scheduler.EstimateLimits(particles, simulation.springDampers);
+
+	particles.positions.assign(positions, positions + numParticles);
+	particles.velocities.assign(velocities, velocities + numParticles);
+	particles.forces.assign(numParticles, glm::vec3(0.0f));
+
+	ColliderSet& colliders = simulation.colliders;
+	const ColliderSet::Plane* planes = this->Array<ColliderSet::Plane>(SECTION_PLANES);
+	const ColliderSet::Sphere* spheres = this->Array<ColliderSet::Sphere>(SECTION_SPHERES);
+	const ColliderSet::Capsule* capsules = this->Array<ColliderSet::Capsule>(SECTION_CAPSULES);
+	const ColliderSet::Box* boxes = this->Array<ColliderSet::Box>(SECTION_BOXES);
+	colliders.planes.assign(planes, planes + header.counts[SECTION_PLANES]);
+	colliders.spheres.assign(spheres, spheres + header.counts[SECTION_SPHERES]);
+	colliders.capsules.assign(capsules, capsules + header.counts[SECTION_CAPSULES]);
+	colliders.boxes.assign(boxes, boxes + header.counts[SECTION_BOXES]);
+	colliders.restitution = header.restitution;
+	colliders.friction = header.friction;
+
+	simulation.integrator = (Integrator)header.integrator;
+	simulation.forceMode = (ForceMode)header.forceMode;
+	simulation.implicitSubsteps = header.implicitSubsteps;
+	simulation.xpbdSubsteps = header.xpbdSubsteps;
+	simulation.xpbdSolver.iterations = header.xpbdIterations;
+	simulation.airVelocity = glm::vec3(header.airVelocity[0], header.airVelocity[1], header.airVelocity[2]);
+	simulation.scheduler.safetyFactor = header.safetyFactor;
+	simulation.selfCollision.enabled = header.selfCollisionEnabled != 0;
+	simulation.selfCollision.thickness = header.selfCollisionThickness;
+
+	simulation.ComputeNormals();
+	return true;
+}
+
+/*
+* Builds a new simulation with the cloths laid out like the ones the open
+* snapshot was taken of and restores the snapshot into it.
+*
+* returns: the new simulation (caller deletes it), or nullptr if the
+* snapshot doesn't fit the layout it describes
+*/
+ClothSimulation* Snapshot::CreateSimulation() const {
+	const Header& header = this->getHeader();
+	ClothSimulation* simulation = new ClothSimulation((Integrator)header.integrator);
+	const ClothLayout* cloths = this->Array<ClothLayout>(SECTION_CLOTHS);
+	for (GLint c = 0; c < header.counts[SECTION_CLOTHS]; c++) {
+		simulation->AddCloth(cloths[c].length, cloths[c].width, cloths[c].particlesL,
+			cloths[c].particlesW, cloths[c].topLeftPos, cloths[c].mass, 0.0f, cloths[c].bending);
+	}
+	simulation->BuildTables();
+
+	if (!this->Restore(*simulation)) {
+		delete simulation;
+		return nullptr;
+	}
+	return simulation;
+}
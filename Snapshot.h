@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ClothSimulation.h"
+#include "MappedFile.h"
+
+/*
+* Checkpoint of a ClothSimulation in a compact binary file: how its cloths
+* were laid out, its settings, the particle state, the spring-damper table
+* and the analytic colliders. Mesh colliders belong to the scene, not the
+* cloth, and aren't saved.
+*
+* The file is a fixed header followed by the raw arrays, each starting on
+* a 16 byte boundary, so opening one maps the file and checks the header;
+* restoring is then one copy per array straight out of the mapping, with
+* nothing to parse. Write goes through a temporary file that is renamed
+* over the old checkpoint, so a crash mid-write leaves the last good one.
+*
+* Files are only read back on machines with the same byte order and float
+* format (checked), and only by the same format version.
+*/
+class Snapshot
+{
+public:
+	static const unsigned int version = 3;
+
+	// arrays following the header, in file order
+	enum Section {
+		SECTION_CLOTHS,
+		SECTION_POSITIONS,
+		SECTION_VELOCITIES,
+		SECTION_MASSES,
+		SECTION_INVERSE_MASSES,
+		SECTION_PINNED,
+		SECTION_SPRINGS,
+		SECTION_PLANES,
+		SECTION_SPHERES,
+		SECTION_CAPSULES,
+		SECTION_BOXES,
+		SECTION_COUNT
+	};
+
+	struct Header {
+		char magic[8];					// "CLTHSNAP"
+		unsigned int version;
+		unsigned int byteOrder;			// byteOrderMark in the writer's byte order
+		unsigned long long fileSize;
+		GLint frame;					// frame count the caller saved with it
+
+		// settings
+		GLint integrator, forceMode;
+		GLint implicitSubsteps, xpbdSubsteps, xpbdIterations;
+		GLfloat airVelocity[3];
+		GLfloat safetyFactor;
+		GLint selfCollisionEnabled;
+		GLfloat selfCollisionThickness;
+		GLfloat restitution, friction;
+
+		// entries in each array and where it starts in the file
+		GLint counts[SECTION_COUNT];
+		unsigned long long offsets[SECTION_COUNT];
+	};
+
+	static bool Write(const ClothSimulation& simulation, GLint frame, const std::string& path);
+
+	bool Open(const std::string& path);
+	void Close();
+
+	const Header& getHeader() const { return *(const Header*)file.data(); }
+
+	bool Restore(ClothSimulation& simulation) const;
+	ClothSimulation* CreateSimulation() const;
+
+private:
+	MappedFile file;
+
+	template <typename T>
+	const T* Array(Section section) const {
+		return (const T*)(file.data() + getHeader().offsets[section]);
+	}
+};
@@ -0,0 +1,170 @@
+#include "SpatialHash.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+// smallest number of items worth handing to another thread
+static const GLint hashGrain = 2048;
+
+// boxes wider than this many cells along any axis (or not finite, from a
+// simulation that blew up) are left out rather than filling the table
+static const GLfloat maxBoxCells = 16.0f;
+
+SpatialHash::SpatialHash() : cellSize(1.0f), bucketMask(0) {
+
+}
+
+/*
+* Rebuilds the table from points, one entry each.
+* 
+* points: positions to bucket, referred to by index
+* cellSize: edge length of a grid cell, at least the query radius
+*/
+void SpatialHash::Build(const std::vector<glm::vec3>& points, GLfloat cellSize) {
+	GLint numPoints = (GLint)points.size();
+	this->cellSize = cellSize;
+
+	keys.resize(numPoints);
+	items.resize(numPoints);
+
+	ThreadPool::Shared().ParallelFor(numPoints, hashGrain, [this, &points](int begin, int end) {
+		for (GLint i = begin; i < end; i++) {
+			GLint x, y, z;
+			this->Cell(points[i], x, y, z);
+			keys[i] = CellKey(x, y, z);
+			items[i] = i;
+		}
+	});
+
+	this->Fill();
+}
+
+/*
+* Rebuilds the table from axis aligned boxes. A box is entered into the
+* cells its low corner can be in while still covering a point of a cell,
+* i.e. the cells overlapping [low, high - cellSize]: just one for boxes no
+* bigger than a cell. Boxes spanning more than maxBoxCells cells are
+* skipped.
+* 
+* lows, highs: corners of each box, referred to by index
+* cellSize: edge length of a grid cell, ideally about the typical box size
+*/
+void SpatialHash::BuildFromBoxes(const std::vector<glm::vec3>& lows, 
+	const std::vector<glm::vec3>& highs, GLfloat cellSize) {
+	ThreadPool& pool = ThreadPool::Shared();
+	GLint numBoxes = (GLint)lows.size();
+	this->cellSize = cellSize;
+
+	// how many cells each box goes into, then where its pairs go
+	itemStart.resize(numBoxes + 1);
+	boxCells.resize(3 * numBoxes);
+	pool.ParallelFor(numBoxes, hashGrain, [this, &lows, &highs](int begin, int end) {
+		for (GLint i = begin; i < end; i++) {
+			glm::vec3 extent = (highs[i] - lows[i]) / this->cellSize;
+			if (!(extent.x <= maxBoxCells && extent.y <= maxBoxCells && extent.z <= maxBoxCells)) {
+				itemStart[i + 1] = 0;
+				continue;
+			}
+
+			GLint x0, y0, z0, x1, y1, z1;
+			this->Cell(lows[i], x0, y0, z0);
+			this->Cell(glm::max(lows[i], highs[i] - glm::vec3(this->cellSize)), x1, y1, z1);
+			itemStart[i + 1] = (x1 - x0 + 1) * (y1 - y0 + 1) * (z1 - z0 + 1);
+
+			boxCells[3 * i] = x0;
+			boxCells[3 * i + 1] = y0;
+			boxCells[3 * i + 2] = z0;
+		}
+	});
+	itemStart[0] = 0;
+	for (GLint i = 0; i < numBoxes; i++) itemStart[i + 1] += itemStart[i];
+
+	keys.resize(itemStart[numBoxes]);
+	items.resize(itemStart[numBoxes]);
+
+	pool.ParallelFor(numBoxes, hashGrain, [this, &lows, &highs](int begin, int end) {
+		for (GLint i = begin; i < end; i++) {
+			if (itemStart[i + 1] == itemStart[i]) continue;
+
+			GLint x0, y0, z0, x1, y1, z1;
+			this->Cell(lows[i], x0, y0, z0);
+			this->Cell(glm::max(lows[i], highs[i] - glm::vec3(this->cellSize)), x1, y1, z1);
+
+			GLint pair = itemStart[i];
+			for (GLint z = z0; z <= z1; z++) {
+				for (GLint y = y0; y <= y1; y++) {
+					for (GLint x = x0; x <= x1; x++) {
+						keys[pair] = CellKey(x, y, z);
+						items[pair] = i;
+						pair++;
+					}
+				}
+			}
+		}
+	});
+
+	this->Fill();
+}
+
+/*
+* Buckets the (key, item) pairs, in parallel: pairs are counted per
+* bucket, buckets laid out with a prefix sum, pairs scattered into them
+* and each bucket sorted back into item order so results don't depend on
+* thread timing.
+*/
+void SpatialHash::Fill() {
+	ThreadPool& pool = ThreadPool::Shared();
+	GLint numPairs = (GLint)keys.size();
+
+	// a few buckets per pair, so the handful of cells a query looks at
+	// rarely share a bucket with unrelated ones
+	GLint numBuckets = 1;
+	while (numBuckets < 4 * numPairs) numBuckets <<= 1;
+	this->bucketMask = (GLuint)numBuckets - 1;
+
+	if ((GLint)cursors.size() != numBuckets) {
+		std::vector<std::atomic<GLint> > fresh(numBuckets);
+		cursors.swap(fresh);
+	}
+	bucketStart.resize(numBuckets + 1);
+
+	// keys become bucket indices from here on
+	pool.ParallelFor(numPairs, hashGrain, [this](int begin, int end) {
+		for (GLint i = begin; i < end; i++) keys[i] &= bucketMask;
+	});
+
+	pool.ParallelFor(numBuckets, hashGrain, [this](int begin, int end) {
+		for (GLint b = begin; b < end; b++) cursors[b].store(0, std::memory_order_relaxed);
+	});
+
+	pool.ParallelFor(numPairs, hashGrain, [this](int begin, int end) {
+		for (GLint i = begin; i < end; i++) {
+			cursors[keys[i]].fetch_add(1, std::memory_order_relaxed);
+		}
+	});
+
+	// counts to start offsets, cursors become each bucket's fill position
+	GLint offset = 0;
+	for (GLint b = 0; b < numBuckets; b++) {
+		bucketStart[b] = offset;
+		offset += cursors[b].load(std::memory_order_relaxed);
+		cursors[b].store(bucketStart[b], std::memory_order_relaxed);
+	}
+	bucketStart[numBuckets] = offset;
+
+	entries.resize(numPairs);
+	pool.ParallelFor(numPairs, hashGrain, [this](int begin, int end) {
+		for (GLint i = begin; i < end; i++) {
+			entries[cursors[keys[i]].fetch_add(1, std::memory_order_relaxed)] = items[i];
+		}
+	});
+
+	pool.ParallelFor(numBuckets, hashGrain, [this](int begin, int end) {
+		for (GLint b = begin; b < end; b++) {
+			if (bucketStart[b + 1] - bucketStart[b] > 1) {
+				std::sort(entries.begin() + bucketStart[b], entries.begin() + bucketStart[b + 1]);
+			}
+		}
+	});
+}
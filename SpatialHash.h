@@ -0,0 +1,122 @@
+#pragma once
+
+#include "physics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+/*
+* Uniform grid over an unbounded space, stored as a hash table of cells.
+* Items (points, or boxes entered by their low corner) are
+* bucketed by cell, CSR style: the items of bucket b are
+* entries[bucketStart[b]] up to entries[bucketStart[b + 1]], in
+* increasing index order. Distinct cells may share a bucket, so callers
+* still have to check actual distances.
+*/
+class SpatialHash
+{
+public:
+	std::vector<GLint> bucketStart;
+	std::vector<GLint> entries;
+
+	SpatialHash();
+
+	void Build(const std::vector<glm::vec3>& points, GLfloat cellSize);
+	void BuildFromBoxes(const std::vector<glm::vec3>& lows, 
+		const std::vector<glm::vec3>& highs, GLfloat cellSize);
+
+	GLfloat getCellSize() const { return cellSize; }
+
+	/*
+	* Calls visit(index) for every point in the 3x3x3 cells around
+	* position, which covers every point within cellSize of it. Each
+	* bucket is visited once even if several of the cells map to it.
+	*/
+	template <typename Visitor>
+	void Query(const glm::vec3& position, Visitor visit) const {
+		if (entries.empty()) return;
+
+		GLint cx, cy, cz;
+		this->Cell(position, cx, cy, cz);
+
+		GLint visited[27];
+		GLint numVisited = 0;
+		for (GLint dz = -1; dz <= 1; dz++) {
+			for (GLint dy = -1; dy <= 1; dy++) {
+				for (GLint dx = -1; dx <= 1; dx++) {
+					GLint bucket = this->Hash(cx + dx, cy + dy, cz + dz);
+
+					bool seen = false;
+					for (GLint v = 0; v < numVisited && !seen; v++) seen = (visited[v] == bucket);
+					if (seen) continue;
+					visited[numVisited++] = bucket;
+
+					for (GLint e = bucketStart[bucket]; e < bucketStart[bucket + 1]; e++) {
+						visit(entries[e]);
+					}
+				}
+			}
+		}
+	}
+
+	/*
+	* Calls visit(index) once for every box that may contain position,
+	* which includes every box that does. Looks in the cell position falls
+	* in and the 7 below it, and only reports a box from the lowest of
+	* those it was entered into.
+	*/
+	template <typename Visitor>
+	void QueryBoxes(const glm::vec3& position, Visitor visit) const {
+		if (entries.empty()) return;
+
+		GLint cx, cy, cz;
+		this->Cell(position, cx, cy, cz);
+
+		for (GLint z = cz - 1; z <= cz; z++) {
+			for (GLint y = cy - 1; y <= cy; y++) {
+				for (GLint x = cx - 1; x <= cx; x++) {
+					GLint bucket = this->Hash(x, y, z);
+
+					for (GLint e = bucketStart[bucket]; e < bucketStart[bucket + 1]; e++) {
+						// a box landing in the bucket through several cells
+						// sits there several times in a row
+						GLint i = entries[e];
+						if (e > bucketStart[bucket] && i == entries[e - 1]) continue;
+
+						const GLint* low = &boxCells[3 * i];
+						if (x != std::max(low[0], cx - 1) || y != std::max(low[1], cy - 1) ||
+							z != std::max(low[2], cz - 1)) continue;
+						visit(i);
+					}
+				}
+			}
+		}
+	}
+
+private:
+	GLfloat cellSize;
+	GLuint bucketMask;	// bucket count - 1, a power of two
+
+	// cell key of every (cell, item) pair, the item it belongs to, where
+	// each item's pairs start, and per-bucket fill counters
+	std::vector<GLuint> keys;
+	std::vector<GLint> items;
+	std::vector<GLint> itemStart;
+	std::vector<GLint> boxCells;	// cell of each box's low corner, xyz
+	std::vector<std::atomic<GLint> > cursors;
+
+	void Cell(const glm::vec3& position, GLint& x, GLint& y, GLint& z) const {
+		x = (GLint)std::floor(position.x / cellSize);
+		y = (GLint)std::floor(position.y / cellSize);
+		z = (GLint)std::floor(position.z / cellSize);
+	}
+	static GLuint CellKey(GLint x, GLint y, GLint z) {
+		return (GLuint)x * 73856093u ^ (GLuint)y * 19349663u ^ (GLuint)z * 83492791u;
+	}
+	GLint Hash(GLint x, GLint y, GLint z) const {
+		return (GLint)(CellKey(x, y, z) & bucketMask);
+	}
+
+	void Fill();
+};
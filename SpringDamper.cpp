@@ -1,39 +1,117 @@
 #include "SpringDamper.h"
 
+#include <algorithm>
+
 /*
-* Constructor.
+* Constructor. Particle indices are stored in ascending order, which
+* doesn't change the force since it is equal and opposite on both ends.
 */
-SpringDamper::SpringDamper(GLint index, GLfloat springConstant, GLfloat dampingConstant, 
-	GLfloat restLength, Particle* particle1, Particle* particle2) : index(index),
-	springConstant(springConstant), dampingConstant(dampingConstant), 
-	restLength(restLength), P1(particle1), P2(particle2) {
-}
-
-SpringDamper::~SpringDamper() {
-
+SpringDamper::SpringDamper(GLint particle1, GLint particle2, GLfloat restLength,
+	GLfloat springConstant, GLfloat dampingConstant) : 
+	P1(std::min(particle1, particle2)), P2(std::max(particle1, particle2)),
+	restLength(restLength), springConstant(springConstant), 
+	dampingConstant(dampingConstant) {
 }
 
 /*
-* Computes forces from spring-damper connecting particles P1 and P2.
-* Applies forces directly to each particle once done.
+* Computes the force from spring-damper connecting particles P1 and P2.
+* Returns the force on P1; P2 receives the negated force.
+* 
+* particles: store the indices P1 and P2 refer into
 */
-void SpringDamper::ComputeForce() {
+glm::vec3 SpringDamper::EvaluateForce(const ParticleSystem& particles) const {
 	// compute current length l & unit vector e
-	glm::vec3 e = P1->getPosition() - P2->getPosition();
+	glm::vec3 e = particles.positions[P1] - particles.positions[P2];
 	GLfloat currentLength = glm::length(e);
 	e = e/currentLength;
 
 	// compute closing velocity
-	GLfloat closeV = glm::dot((P1->getVelocity() - P2->getVelocity()), e);
+	GLfloat closeV = glm::dot((particles.velocities[P1] - particles.velocities[P2]), e);
 
 	// compute final forces
 	GLfloat springForce = (-springConstant) * (currentLength - restLength);
 	GLfloat dampingForce = ((-dampingConstant) * closeV);
 	GLfloat forceConst =  springForce + dampingForce;
-	glm::vec3 force1 = forceConst * e;
+	return forceConst * e;
+}
+
+/*
+* Computes forces from spring-damper connecting particles P1 and P2.
+* Applies forces directly to each particle once done.
+* 
+* particles: store the indices P1 and P2 refer into
+*/
+void SpringDamper::ComputeForce(ParticleSystem& particles) const {
+	glm::vec3 force1 = EvaluateForce(particles);
 	glm::vec3 force2 = -force1;
 
 	// apply final forces to each particle
-	P1->ApplyForce(force1);
-	P2->ApplyForce(force2);
-}
\ No newline at end of file
+	particles.ApplyForce(P1, force1);
+	particles.ApplyForce(P2, force2);
+}
+
+/*
+* Sorts a constraint table by its first and then second particle index, so
+* walking the table touches the particle arrays (mostly) front to back.
+*/
+void SpringDamper::SortTable(std::vector<SpringDamper>& table) {
+	std::sort(table.begin(), table.end(), 
+		[](const SpringDamper& a, const SpringDamper& b) {
+			if (a.P1 != b.P1) return a.P1 < b.P1;
+			return a.P2 < b.P2;
+		});
+}
+
+/*
+* Groups a (sorted) table into colors where no two spring-dampers of the
+* same color share a particle, so each color can be applied in parallel
+* without two threads writing the same force. Entries are reordered so
+* every color is contiguous, keeping their relative order inside a color.
+* 
+* table: constraint table to reorder
+* numParticles: number of particles the table indexes into
+* colorOffsets: filled with the start of each color, plus the table size
+*/
+void SpringDamper::ColorTable(std::vector<SpringDamper>& table, GLint numParticles,
+	std::vector<GLint>& colorOffsets) {
+	// bit c is set once a particle is touched by a spring of color c. A
+	// particle has far fewer than 32 springs, so 64 colors always suffice
+	std::vector<unsigned long long> usedColors(numParticles, 0);
+	std::vector<GLint> colors(table.size());
+	GLint numColors = 0;
+
+	// greedily give each spring the lowest color free at both ends
+	for (size_t i = 0; i < table.size(); i++) {
+		unsigned long long used = usedColors[table[i].P1] | usedColors[table[i].P2];
+		GLint color = 0;
+		while (used & (1ull << color)) color++;
+
+		colors[i] = color;
+		usedColors[table[i].P1] |= 1ull << color;
+		usedColors[table[i].P2] |= 1ull << color;
+		numColors = std::max(numColors, color + 1);
+	}
+
+	// count each color, then turn counts into start offsets
+	colorOffsets.assign(numColors + 1, 0);
+	for (GLint color : colors) colorOffsets[color + 1]++;
+	for (GLint c = 0; c < numColors; c++) colorOffsets[c + 1] += colorOffsets[c];
+
+	// scatter into color order
+	std::vector<SpringDamper> colored(table);
+	std::vector<GLint> cursor(colorOffsets.begin(), colorOffsets.end() - 1);
+	for (size_t i = 0; i < table.size(); i++) {
+		colored[cursor[colors[i]]++] = table[i];
+	}
+	table.swap(colored);
+}
+
+/*
+* Applies the force of every spring-damper in a table.
+*/
+void SpringDamper::ComputeForces(const std::vector<SpringDamper>& table,
+	ParticleSystem& particles) {
+	for (const SpringDamper& sd : table) {
+		sd.ComputeForce(particles);
+	}
+}
@@ -1,27 +1,35 @@
 #pragma once
 
-#include "Particle.h"
+#include "ParticleSystem.h"
 
+/*
+* One entry of a flat spring-damper constraint table. Entries only store
+* particle indices and constants, so a whole table of them is a single
+* contiguous allocation that can be sorted for locality.
+*/
 class SpringDamper
 {
 private:
 
 
 public:
-	const GLfloat springConstant;
-	const GLfloat dampingConstant;
-	GLfloat restLength;
-
-	// pointers to each particle
-	Particle *P1, *P2;
+	// indices of each particle in the ParticleSystem (P1 < P2)
+	GLint P1, P2;
 
-	GLint index;	// keeps track of which SpringDamper this is
+	GLfloat restLength;
+	GLfloat springConstant;
+	GLfloat dampingConstant;
 
-	SpringDamper(GLint index, GLfloat springConstant, GLfloat dampingConstant,
-		GLfloat restLength, Particle* particle1, Particle* particle2);
-	~SpringDamper();
+	SpringDamper(GLint particle1, GLint particle2, GLfloat restLength,
+		GLfloat springConstant, GLfloat dampingConstant);
 
-	void ComputeForce();
+	glm::vec3 EvaluateForce(const ParticleSystem& particles) const;
+	void ComputeForce(ParticleSystem& particles) const;
 
+	// helpers that operate on a whole table at once
+	static void SortTable(std::vector<SpringDamper>& table);
+	static void ColorTable(std::vector<SpringDamper>& table, GLint numParticles,
+		std::vector<GLint>& colorOffsets);
+	static void ComputeForces(const std::vector<SpringDamper>& table,
+		ParticleSystem& particles);
 };
-
@@ -0,0 +1,229 @@
+#include "SpringKernel.h"
+
+#include "CpuFeatures.h"
+
+#ifdef CLOTH_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// kernels read particle arrays as flat floats, x y z per particle
+static_assert(sizeof(glm::vec3) == 3 * sizeof(GLfloat), "glm::vec3 must be tightly packed");
+
+// raw pointers for one Evaluate call, shared by every kernel version
+struct SpringBatch
+{
+	const GLint *p1, *p2;
+	const GLfloat *rest, *stiffness, *damping;
+	const GLfloat *pos, *vel;
+	GLfloat *fx, *fy, *fz;
+};
+
+typedef void (*SpringBatchFunc)(const SpringBatch& b, GLint begin, GLint end);
+
+/*
+* Reference version, same math as SpringDamper::EvaluateForce.
+*/
+static void EvaluateScalar(const SpringBatch& b, GLint begin, GLint end) {
+	for (GLint i = begin; i < end; i++) {
+		const GLfloat* x1 = b.pos + 3 * b.p1[i];
+		const GLfloat* x2 = b.pos + 3 * b.p2[i];
+		const GLfloat* v1 = b.vel + 3 * b.p1[i];
+		const GLfloat* v2 = b.vel + 3 * b.p2[i];
+
+		// compute current length l & unit vector e
+		GLfloat ex = x1[0] - x2[0], ey = x1[1] - x2[1], ez = x1[2] - x2[2];
+		GLfloat currentLength = std::sqrt(ex * ex + ey * ey + ez * ez);
+		GLfloat invLength = 1.0f / currentLength;
+		ex *= invLength; ey *= invLength; ez *= invLength;
+
+		// compute closing velocity
+		GLfloat closeV = (v1[0] - v2[0]) * ex + (v1[1] - v2[1]) * ey + (v1[2] - v2[2]) * ez;
+
+		// compute final force
+		GLfloat forceConst = (-b.stiffness[i]) * (currentLength - b.rest[i]) - b.damping[i] * closeV;
+		b.fx[i] = forceConst * ex;
+		b.fy[i] = forceConst * ey;
+		b.fz[i] = forceConst * ez;
+	}
+}
+
+#ifdef CLOTH_X86_SIMD
+
+/*
+* 8 spring-dampers per iteration. Particle data is fetched with gathers
+* since the endpoints of neighboring springs aren't contiguous.
+*/
+CLOTH_TARGET_AVX2 static void EvaluateAVX2(const SpringBatch& b, GLint begin, GLint end) {
+	const __m256 one = _mm256_set1_ps(1.0f);
+	GLint i = begin;
+
+	for (; i + 8 <= end; i += 8) {
+		// particle indices to float offsets (3 floats per particle)
+		__m256i i1 = _mm256_loadu_si256((const __m256i*)(b.p1 + i));
+		__m256i i2 = _mm256_loadu_si256((const __m256i*)(b.p2 + i));
+		i1 = _mm256_add_epi32(i1, _mm256_add_epi32(i1, i1));
+		i2 = _mm256_add_epi32(i2, _mm256_add_epi32(i2, i2));
+
+		// compute current length l & unit vector e
+		__m256 ex = _mm256_sub_ps(_mm256_i32gather_ps(b.pos, i1, 4), _mm256_i32gather_ps(b.pos, i2, 4));
+		__m256 ey = _mm256_sub_ps(_mm256_i32gather_ps(b.pos + 1, i1, 4), _mm256_i32gather_ps(b.pos + 1, i2, 4));
+		__m256 ez = _mm256_sub_ps(_mm256_i32gather_ps(b.pos + 2, i1, 4), _mm256_i32gather_ps(b.pos + 2, i2, 4));
+
+		__m256 lengthSq = _mm256_add_ps(_mm256_mul_ps(ex, ex),
+			_mm256_add_ps(_mm256_mul_ps(ey, ey), _mm256_mul_ps(ez, ez)));
+		__m256 currentLength = _mm256_sqrt_ps(lengthSq);
+		__m256 invLength = _mm256_div_ps(one, currentLength);
+		ex = _mm256_mul_ps(ex, invLength);
+		ey = _mm256_mul_ps(ey, invLength);
+		ez = _mm256_mul_ps(ez, invLength);
+
+		// compute closing velocity
+		__m256 dvx = _mm256_sub_ps(_mm256_i32gather_ps(b.vel, i1, 4), _mm256_i32gather_ps(b.vel, i2, 4));
+		__m256 dvy = _mm256_sub_ps(_mm256_i32gather_ps(b.vel + 1, i1, 4), _mm256_i32gather_ps(b.vel + 1, i2, 4));
+		__m256 dvz = _mm256_sub_ps(_mm256_i32gather_ps(b.vel + 2, i1, 4), _mm256_i32gather_ps(b.vel + 2, i2, 4));
+		__m256 closeV = _mm256_add_ps(_mm256_mul_ps(dvx, ex),
+			_mm256_add_ps(_mm256_mul_ps(dvy, ey), _mm256_mul_ps(dvz, ez)));
+
+		// compute final force: -k (l - rest) - d closeV
+		__m256 stretch = _mm256_sub_ps(currentLength, _mm256_loadu_ps(b.rest + i));
+		__m256 forceConst = _mm256_sub_ps(
+			_mm256_setzero_ps(),
+			_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(b.stiffness + i), stretch),
+				_mm256_mul_ps(_mm256_loadu_ps(b.damping + i), closeV)));
+
+		_mm256_storeu_ps(b.fx + i, _mm256_mul_ps(forceConst, ex));
+		_mm256_storeu_ps(b.fy + i, _mm256_mul_ps(forceConst, ey));
+		_mm256_storeu_ps(b.fz + i, _mm256_mul_ps(forceConst, ez));
+	}
+
+	EvaluateScalar(b, i, end);
+}
+
+/*
+* Same as EvaluateAVX2 with 16 spring-dampers per iteration.
+*/
+CLOTH_TARGET_AVX512 static void EvaluateAVX512(const SpringBatch& b, GLint begin, GLint end) {
+	const __m512 one = _mm512_set1_ps(1.0f);
+	GLint i = begin;
+
+	for (; i + 16 <= end; i += 16) {
+		// particle indices to float offsets (3 floats per particle)
+		__m512i i1 = _mm512_loadu_si512((const void*)(b.p1 + i));
+		__m512i i2 = _mm512_loadu_si512((const void*)(b.p2 + i));
+		i1 = _mm512_add_epi32(i1, _mm512_add_epi32(i1, i1));
+		i2 = _mm512_add_epi32(i2, _mm512_add_epi32(i2, i2));
+
+		// compute current length l & unit vector e
+		__m512 ex = _mm512_sub_ps(_mm512_i32gather_ps(i1, b.pos, 4), _mm512_i32gather_ps(i2, b.pos, 4));
+		__m512 ey = _mm512_sub_ps(_mm512_i32gather_ps(i1, b.pos + 1, 4), _mm512_i32gather_ps(i2, b.pos + 1, 4));
+		__m512 ez = _mm512_sub_ps(_mm512_i32gather_ps(i1, b.pos + 2, 4), _mm512_i32gather_ps(i2, b.pos + 2, 4));
+
+		__m512 lengthSq = _mm512_add_ps(_mm512_mul_ps(ex, ex),
+			_mm512_add_ps(_mm512_mul_ps(ey, ey), _mm512_mul_ps(ez, ez)));
+		__m512 currentLength = _mm512_sqrt_ps(lengthSq);
+		__m512 invLength = _mm512_div_ps(one, currentLength);
+		ex = _mm512_mul_ps(ex, invLength);
+		ey = _mm512_mul_ps(ey, invLength);
+		ez = _mm512_mul_ps(ez, invLength);
+
+		// compute closing velocity
+		__m512 dvx = _mm512_sub_ps(_mm512_i32gather_ps(i1, b.vel, 4), _mm512_i32gather_ps(i2, b.vel, 4));
+		__m512 dvy = _mm512_sub_ps(_mm512_i32gather_ps(i1, b.vel + 1, 4), _mm512_i32gather_ps(i2, b.vel + 1, 4));
+		__m512 dvz = _mm512_sub_ps(_mm512_i32gather_ps(i1, b.vel + 2, 4), _mm512_i32gather_ps(i2, b.vel + 2, 4));
+		__m512 closeV = _mm512_add_ps(_mm512_mul_ps(dvx, ex),
+			_mm512_add_ps(_mm512_mul_ps(dvy, ey), _mm512_mul_ps(dvz, ez)));
+
+		// compute final force: -k (l - rest) - d closeV
+		__m512 stretch = _mm512_sub_ps(currentLength, _mm512_loadu_ps(b.rest + i));
+		__m512 forceConst = _mm512_sub_ps(
+			_mm512_setzero_ps(),
+			_mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(b.stiffness + i), stretch),
+				_mm512_mul_ps(_mm512_loadu_ps(b.damping + i), closeV)));
+
+		_mm512_storeu_ps(b.fx + i, _mm512_mul_ps(forceConst, ex));
+		_mm512_storeu_ps(b.fy + i, _mm512_mul_ps(forceConst, ey));
+		_mm512_storeu_ps(b.fz + i, _mm512_mul_ps(forceConst, ez));
+	}
+
+	EvaluateAVX2(b, i, end);
+}
+
+#endif
+
+static const char* kernelName = "scalar";
+
+/*
+* Picks the widest kernel this CPU can run.
+*/
+static SpringBatchFunc SelectKernel() {
+#ifdef CLOTH_X86_SIMD
+	if (CpuFeatures::HasAVX512()) {
+		kernelName = "AVX-512";
+		return EvaluateAVX512;
+	}
+	if (CpuFeatures::HasAVX2()) {
+		kernelName = "AVX2";
+		return EvaluateAVX2;
+	}
+#endif
+	return EvaluateScalar;
+}
+
+// selected on first use, not during static initialization
+static SpringBatchFunc GetKernel() {
+	static const SpringBatchFunc kernel = SelectKernel();
+	return kernel;
+}
+
+/*
+* Copies a constraint table into the kernel's own arrays. Has to be
+* called again whenever the table changes.
+* 
+* table: spring-damper table to mirror
+*/
+void SpringKernel::Build(const std::vector<SpringDamper>& table) {
+	P1.resize(table.size());
+	P2.resize(table.size());
+	restLength.resize(table.size());
+	springConstant.resize(table.size());
+	dampingConstant.resize(table.size());
+
+	for (size_t i = 0; i < table.size(); i++) {
+		P1[i] = table[i].P1;
+		P2[i] = table[i].P2;
+		restLength[i] = table[i].restLength;
+		springConstant[i] = table[i].springConstant;
+		dampingConstant[i] = table[i].dampingConstant;
+	}
+
+	forceX.assign(table.size(), 0.0f);
+	forceY.assign(table.size(), 0.0f);
+	forceZ.assign(table.size(), 0.0f);
+}
+
+/*
+* Evaluates the force of spring-dampers [begin, end) into forceX/Y/Z.
+* Different ranges can be evaluated from different threads.
+* 
+* particles: store the spring-dampers index into
+*/
+void SpringKernel::Evaluate(const ParticleSystem& particles, GLint begin, GLint end) {
+	SpringBatch b;
+	b.p1 = P1.data();
+	b.p2 = P2.data();
+	b.rest = restLength.data();
+	b.stiffness = springConstant.data();
+	b.damping = dampingConstant.data();
+	b.pos = (const GLfloat*)particles.positions.data();
+	b.vel = (const GLfloat*)particles.velocities.data();
+	b.fx = forceX.data();
+	b.fy = forceY.data();
+	b.fz = forceZ.data();
+
+	GetKernel()(b, begin, end);
+}
+
+const char* SpringKernel::InstructionSet() {
+	GetKernel();
+	return kernelName;
+}
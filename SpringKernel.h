@@ -0,0 +1,30 @@
+#pragma once
+
+#include "SpringDamper.h"
+
+/*
+* Structure-of-arrays copy of a spring-damper table together with a SIMD
+* kernel that evaluates many spring forces per iteration. The widest
+* version the CPU supports (AVX-512, AVX2 or scalar) is picked at runtime.
+*/
+class SpringKernel
+{
+public:
+	// constraint data, one entry per spring-damper in table order
+	std::vector<GLint> P1, P2;
+	std::vector<GLfloat> restLength;
+	std::vector<GLfloat> springConstant;
+	std::vector<GLfloat> dampingConstant;
+
+	// output: force on P1 of each spring-damper (P2 gets the negation)
+	std::vector<GLfloat> forceX, forceY, forceZ;
+
+	void Build(const std::vector<SpringDamper>& table);
+	GLint size() const { return (GLint)P1.size(); }
+
+	void Evaluate(const ParticleSystem& particles, GLint begin, GLint end);
+	glm::vec3 getForce(GLint i) const { return glm::vec3(forceX[i], forceY[i], forceZ[i]); }
+
+	// name of the instruction set Evaluate runs on
+	static const char* InstructionSet();
+};
@@ -0,0 +1,110 @@
+#include "StreamingBuffer.h"
+
+
+StreamingBuffer::StreamingBuffer() : buffer(0), regionSize(0), 
+	persistent(false), region(0), mapped(nullptr) {
+	for (GLint i = 0; i < regions; i++) fences[i] = 0;
+}
+
+StreamingBuffer::~StreamingBuffer() {
+	for (GLint i = 0; i < regions; i++) {
+		if (fences[i]) glDeleteSync(fences[i]);
+	}
+
+	if (mapped) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	if (buffer) glDeleteBuffers(1, &buffer);
+}
+
+bool StreamingBuffer::SupportsPersistentMapping() {
+#if defined(__APPLE__) || !defined(GL_MAP_PERSISTENT_BIT)
+	// macOS stops at GL 4.1
+	return false;
+#else
+	return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+#endif
+}
+
+/*
+* Allocates the GL buffer. Leaves GL_ARRAY_BUFFER bound to it, so vertex
+* attributes can be pointed at it right after.
+* 
+* regionSize: bytes written per frame
+*/
+void StreamingBuffer::Create(GLsizeiptr regionSize) {
+	this->regionSize = regionSize;
+	this->persistent = SupportsPersistentMapping();
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+#if !defined(__APPLE__) && defined(GL_MAP_PERSISTENT_BIT)
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, regionSize * regions, nullptr, flags);
+		mapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize * regions, flags);
+
+		// this shouldn't fail, but fall back rather than crash if it does
+		if (mapped) return;
+		glDeleteBuffers(1, &buffer);
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		this->persistent = false;
+	}
+#endif
+
+	glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+}
+
+/*
+* Returns where to write this frame's regionSize bytes. Persistent
+* buffers only wait if the GPU is still reading the current region from
+* regions frames ago; otherwise the old storage is orphaned so the driver
+* never has to wait either.
+*/
+void* StreamingBuffer::Map() {
+	if (persistent) {
+		GLsync& fence = fences[region];
+		if (fence) {
+			GLenum result = glClientWaitSync(fence, 0, 0);
+			while (result == GL_TIMEOUT_EXPIRED) {
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			}
+			glDeleteSync(fence);
+			fence = 0;
+		}
+
+		return mapped + region * regionSize;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+	return glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize, 
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+}
+
+/*
+* Finishes writing. Persistent buffers are coherent and stay mapped.
+*/
+void StreamingBuffer::Unmap() {
+	if (persistent) return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/*
+* Marks the current region as in use by the draw calls issued so far and
+* moves on to the next one. Call after the last draw that reads this
+* frame's data.
+*/
+void StreamingBuffer::Fence() {
+	if (!persistent) return;
+
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	region = (region + 1) % regions;
+}
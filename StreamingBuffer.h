@@ -0,0 +1,46 @@
+#pragma once
+
+#include "core.h"
+
+/*
+* Vertex buffer for data that is rewritten every frame. Where the driver
+* supports it (GL 4.4 / ARB_buffer_storage) the buffer holds several
+* copies (regions) of the data and stays mapped for good: each frame
+* writes the next region while the GPU may still be reading the previous
+* ones, with a fence per region so a region is never overwritten before
+* the draw that reads it has finished. Otherwise the buffer is orphaned
+* and mapped again every frame (GL_STREAM_DRAW).
+* 
+* Usage per frame: Map, write regionSize bytes, Unmap, draw from
+* getRegion() (e.g. as base vertex), Fence.
+*/
+class StreamingBuffer
+{
+public:
+	static const GLint regions = 3;
+
+	StreamingBuffer();
+	~StreamingBuffer();
+
+	void Create(GLsizeiptr regionSize);
+
+	void* Map();
+	void Unmap();
+	void Fence();
+
+	GLuint getBuffer() const { return buffer; }
+	GLint getRegion() const { return region; }
+	bool isPersistent() const { return persistent; }
+
+	// whether this context can keep buffers persistently mapped
+	static bool SupportsPersistentMapping();
+
+private:
+	GLuint buffer;
+	GLsizeiptr regionSize;
+
+	bool persistent;
+	GLint region;				// region the current frame goes into
+	unsigned char* mapped;		// start of the whole buffer if persistent
+	GLsync fences[regions];		// set once the GPU may be reading a region
+};
@@ -0,0 +1,119 @@
+#include "SubstepScheduler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+/*
+* Constructor.
+*/
+SubstepScheduler::SubstepScheduler() {
+	this->fixedTimeStep = 1.0f / 40.0f;
+	this->safetyFactor = 0.9f;
+	this->minSubsteps = 1;
+	this->maxSubsteps = 1000;
+	this->maxStepsPerAdvance = 4;
+
+	this->stableDeltaTime = FLT_MAX;
+	this->minRestLength = FLT_MAX;
+	this->accumulator = 0.0f;
+}
+
+// largest absolute row sum, an upper bound on the eigenvalues of m
+static GLfloat RowSumNorm(const glm::mat3& m) {
+	GLfloat norm = 0.0f;
+	for (int row = 0; row < 3; row++) {
+		norm = std::max(norm, std::abs(m[0][row]) + std::abs(m[1][row]) + std::abs(m[2][row]));
+	}
+	return norm;
+}
+
+/*
+* Estimates the largest stable semi-implicit Euler step from the
+* constraint table. Each spring-damper along direction e contributes
+* k e e^T to the stiffness of both of its particles, and the fastest
+* (checkerboard) mode of a particle sees about twice its summed stiffness,
+* so w^2 ~ 2 |sum(k e e^T)| / m_i, which needs h < 2 / w. The dampers
+* likewise need h < 2 m_i / (2 |sum(d e e^T)|). Has to be called again
+* when the table or masses change.
+* 
+* particles: store the table indexes into
+* springs: spring-damper table
+*/
+void SubstepScheduler::EstimateLimits(const ParticleSystem& particles,
+	const std::vector<SpringDamper>& springs) {
+	GLint numParticles = particles.size();
+	std::vector<glm::mat3> stiffness(numParticles, glm::mat3(0.0f));
+	std::vector<glm::mat3> damping(numParticles, glm::mat3(0.0f));
+
+	this->minRestLength = FLT_MAX;
+	for (const SpringDamper& sd : springs) {
+		glm::vec3 e = glm::normalize(particles.positions[sd.P1] - particles.positions[sd.P2]);
+		glm::mat3 eeT = glm::outerProduct(e, e);
+
+		stiffness[sd.P1] = stiffness[sd.P1] + sd.springConstant * eeT;
+		stiffness[sd.P2] = stiffness[sd.P2] + sd.springConstant * eeT;
+		damping[sd.P1] = damping[sd.P1] + sd.dampingConstant * eeT;
+		damping[sd.P2] = damping[sd.P2] + sd.dampingConstant * eeT;
+		minRestLength = std::min(minRestLength, sd.restLength);
+	}
+
+	this->stableDeltaTime = FLT_MAX;
+	for (GLint i = 0; i < numParticles; i++) {
+		if (particles.pinned[i]) continue;
+
+		GLfloat mass = particles.masses[i];
+		GLfloat maxStiffness = 2.0f * RowSumNorm(stiffness[i]);
+		GLfloat maxDamping = 2.0f * RowSumNorm(damping[i]);
+
+		if (maxStiffness > 0.0f) {
+			stableDeltaTime = std::min(stableDeltaTime, 2.0f / std::sqrt(maxStiffness / mass));
+		}
+		if (maxDamping > 0.0f) {
+			stableDeltaTime = std::min(stableDeltaTime, 2.0f * mass / maxDamping);
+		}
+	}
+}
+
+/*
+* Number of substeps to split the next frame step into, given how fast
+* the particles currently move.
+* 
+* particles: current state
+*/
+GLint SubstepScheduler::ComputeSubsteps(const ParticleSystem& particles) const {
+	GLfloat deltaTime = stableDeltaTime;
+
+	// don't let anything cross more than half a rest length per substep
+	GLfloat maxSpeedSq = 0.0f;
+	for (const glm::vec3& v : particles.velocities) {
+		maxSpeedSq = std::max(maxSpeedSq, glm::dot(v, v));
+	}
+	if (maxSpeedSq > 0.0f && minRestLength < FLT_MAX) {
+		deltaTime = std::min(deltaTime, 0.5f * minRestLength / std::sqrt(maxSpeedSq));
+	}
+
+	GLfloat substeps = std::ceil(fixedTimeStep / (safetyFactor * deltaTime));
+	if (!(substeps < (GLfloat)maxSubsteps)) return maxSubsteps;
+	return std::max(minSubsteps, (GLint)substeps);
+}
+
+/*
+* Adds wall-clock time to the accumulator and returns how many fixed
+* frame steps to simulate now.
+* 
+* elapsedTime: seconds since the last call
+*/
+GLint SubstepScheduler::Advance(GLfloat elapsedTime) {
+	accumulator += std::max(0.0f, elapsedTime);
+
+	GLint steps = (GLint)(accumulator / fixedTimeStep);
+	accumulator -= steps * fixedTimeStep;
+
+	// after a long stall, catch up a little instead of all at once
+	if (steps > maxStepsPerAdvance) {
+		steps = maxStepsPerAdvance;
+	}
+
+	return steps;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "SpringDamper.h"
+
+/*
+* Decides how many explicit substeps a frame needs, and how many frames
+* to simulate for a given amount of wall-clock time.
+* 
+* The stable substep size comes from an estimate of the spring
+* stiffness/damping over particle mass, which only changes with the
+* constraint tables, and a CFL-like limit so no particle travels more than
+* a fraction of the shortest rest length per substep. Wall-clock time is
+* collected in a fixed-timestep accumulator so the simulation runs at the
+* same speed no matter the frame rate.
+*/
+class SubstepScheduler
+{
+public:
+	GLfloat fixedTimeStep;		// simulated seconds per frame step
+	GLfloat safetyFactor;		// fraction of the stability limit to use
+	GLint minSubsteps, maxSubsteps;
+	GLint maxStepsPerAdvance;	// drop time rather than fall further behind
+
+	SubstepScheduler();
+
+	void EstimateLimits(const ParticleSystem& particles, 
+		const std::vector<SpringDamper>& springs);
+	GLint ComputeSubsteps(const ParticleSystem& particles) const;
+
+	GLint Advance(GLfloat elapsedTime);
+	// fraction of a frame step left over in the accumulator
+	GLfloat getAlpha() const { return accumulator / fixedTimeStep; }
+
+	GLfloat getStableDeltaTime() const { return stableDeltaTime; }
+
+private:
+	GLfloat stableDeltaTime;	// limit from stiffness and damping alone
+	GLfloat minRestLength;
+	GLfloat accumulator;
+};
@@ -0,0 +1,117 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+// set while this thread runs chunks of a pool job, so a task that calls
+// ParallelFor again runs its loop inline instead of re-locking jobMutex
+static thread_local bool insideJob = false;
+
+/*
+* Constructor.
+* numWorkers: number of threads to spawn in addition to the caller
+*/
+ThreadPool::ThreadPool(unsigned int numWorkers) : stopping(false), 
+	task(nullptr), count(0), chunkSize(1), nextChunk(0), generation(0),
+	activeWorkers(0) {
+	for (unsigned int i = 0; i < numWorkers; i++) {
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& t : workers) {
+		t.join();
+	}
+}
+
+ThreadPool& ThreadPool::Shared() {
+	static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+/*
+* Runs task over [0, count), split into chunks of roughly grainSize
+* indices. Small loops, and loops started from inside a task, run
+* directly on the calling thread.
+* 
+* count: number of loop indices
+* grainSize: smallest chunk worth handing to another thread
+* task: work to do for each chunk
+*/
+void ThreadPool::ParallelFor(int count, int grainSize, const Task& task) {
+	if (count <= 0) return;
+
+	// not worth waking anyone up
+	if (workers.empty() || count <= grainSize) {
+		task(0, count);
+		return;
+	}
+
+	// a task calling back in already holds the pool (or is one of its
+	// workers), so it does its loop by itself
+	if (insideJob) {
+		task(0, count);
+		return;
+	}
+
+	// the pool runs one job at a time; a second thread does its loop by
+	// itself rather than waiting for the pool
+	std::unique_lock<std::mutex> busy(jobMutex, std::try_to_lock);
+	if (!busy.owns_lock()) {
+		task(0, count);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task = &task;
+		this->count = count;
+		// a few chunks per thread so uneven chunks balance out
+		this->chunkSize = std::max(grainSize, count / (int)(4 * size()));
+		this->nextChunk = 0;
+		this->activeWorkers = (unsigned int)workers.size();
+		this->generation++;
+	}
+	wake.notify_all();
+
+	RunChunks();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return activeWorkers == 0; });
+	this->task = nullptr;
+}
+
+void ThreadPool::WorkerLoop() {
+	unsigned int seenGeneration = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+			if (stopping) return;
+			seenGeneration = generation;
+		}
+
+		RunChunks();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--activeWorkers == 0) done.notify_one();
+	}
+}
+
+void ThreadPool::RunChunks() {
+	insideJob = true;
+	while (true) {
+		int begin = nextChunk.fetch_add(chunkSize);
+		if (begin >= count) break;
+
+		(*task)(begin, std::min(begin + chunkSize, count));
+	}
+	insideJob = false;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+* Small fork-join pool used to split simulation loops across cores.
+* ParallelFor blocks until every chunk has run; the calling thread
+* takes chunks as well, so a pool of N threads keeps N+1 cores busy.
+*/
+class ThreadPool
+{
+public:
+	// task receives a half-open range [begin, end) of loop indices
+	typedef std::function<void(int, int)> Task;
+
+	ThreadPool(unsigned int numWorkers);
+	~ThreadPool();
+
+	unsigned int size() const { return (unsigned int)workers.size() + 1; }
+
+	void ParallelFor(int count, int grainSize, const Task& task);
+
+	// pool shared by every cloth, sized to the machine
+	static ThreadPool& Shared();
+
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::mutex jobMutex;	// held by whoever is running a job on the pool
+	std::condition_variable wake, done;
+	bool stopping;
+
+	// current job, only valid while a ParallelFor is running
+	const Task* task;
+	int count, chunkSize;
+	std::atomic<int> nextChunk;
+	std::atomic<unsigned int> generation;
+	unsigned int activeWorkers;
+
+	void WorkerLoop();
+	void RunChunks();
+};
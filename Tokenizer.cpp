@@ -6,58 +6,67 @@
 
 #include "Tokenizer.h"
 
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
 ////////////////////////////////////////////////////////////////////////////////
 
 Tokenizer::Tokenizer() {
-	File=0;
+	Cursor=End=0;
 	LineNum=0;
-	strcpy(FileName,"");
+	ErrorCount=0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 Tokenizer::~Tokenizer() {
-	if(File) {
-		printf("ERROR: Tokenizer::~Tokenizer()- Closing file '%s'\n",FileName);
-		fclose((FILE*)File);
+	if(File.isOpen()) {
+		printf("ERROR: Tokenizer::~Tokenizer()- Closing file '%s'\n",FileName.c_str());
 	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Tokenizer::Open(const char *fname) {
-	File=(void*)fopen(fname,"r");
 	LineNum=1;
-	if(File==0) {
+	ErrorCount=0;
+	if(!File.Open(fname)) {
 		printf("ERROR: Tokenzier::Open()- Can't open file '%s'\n",fname);
 		return false;
 	}
-	strcpy(FileName,fname);
+	Cursor=(const char*)File.data();
+	End=Cursor+File.size();
+	FileName=fname;
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Tokenizer::Close() {
-	if(File) fclose((FILE*)File);
-	else return false;
+	if(!File.isOpen()) return false;
 
-	File=0;
+	File.Close();
+	Cursor=End=0;
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-bool Tokenizer::Abort(char *error) {
-	printf("ERROR '%s' line %d: %s\n",FileName,LineNum,error);
+bool Tokenizer::Abort(const char *error) {
+	printf("ERROR '%s' line %d: %s\n",FileName.c_str(),LineNum,error);
 	Close();
 	return false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Both return EOF (as a char) at the end of the file, like getc
+
 char Tokenizer::GetChar() {
-	char c=char(getc((FILE*)File));
+	if(Cursor==End) return char(EOF);
+	char c=*Cursor++;
 	if(c=='\n') LineNum++;
 	return c;
 }
@@ -65,103 +74,100 @@ char Tokenizer::GetChar() {
 ////////////////////////////////////////////////////////////////////////////////
 
 char Tokenizer::CheckChar() {
-	int c=getc((FILE*)File);
-	ungetc(c,(FILE*)File);
-	return char(c);
+	if(Cursor==End) return char(EOF);
+	return *Cursor;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Length of the number starting at the cursor, 0 if there is none there.
+// Integers: [+|-]I
+// Floats: [+|-](I|I.|.I|I.I)[(e|E)[+|-]I]
+
+int Tokenizer::ScanNumber(bool fraction) {
+	const char *p=Cursor;
+	if(p<End && (*p=='+' || *p=='-')) p++;
+
+	const char *digits=p;
+	while(p<End && isdigit((unsigned char)*p)) p++;
+	bool mantissa=p>digits;
+
+	if(fraction) {
+		if(p<End && *p=='.') {
+			p++;
+			const char *fractionDigits=p;
+			while(p<End && isdigit((unsigned char)*p)) p++;
+			mantissa=mantissa || p>fractionDigits;
+		}
+		if(mantissa && p<End && (*p=='e' || *p=='E')) {
+			p++;
+			if(p<End && (*p=='+' || *p=='-')) p++;
+			const char *exponentDigits=p;
+			while(p<End && isdigit((unsigned char)*p)) p++;
+			if(p==exponentDigits) return 0;
+		}
+	}
+
+	return mantissa ? int(p-Cursor) : 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 int Tokenizer::GetInt() {
 	SkipWhitespace();
-	int pos=0;
-	char temp[256];
 
-	// Get first character ('-' or digit)
-	char c=CheckChar();
-	if(c=='-') {
-		temp[pos++]=GetChar();
-		c=CheckChar();
-	}
-	if(!isdigit(c)) {
-		printf("ERROR: Tokenizer::GetInt()- Expecting int on line %d of '%s'\n",LineNum,FileName);
+	// the mapping isn't null terminated, so convert a copy
+	char temp[32];
+	int length=ScanNumber(false);
+	if(length==0 || length>=int(sizeof(temp))) {
+		printf("ERROR: Tokenizer::GetInt()- Expecting int on line %d of '%s'\n",LineNum,FileName.c_str());
+		ErrorCount++;
 		return 0;
 	}
-	temp[pos++]=GetChar();
+	memcpy(temp,Cursor,length);
+	temp[length]='\0';
+	Cursor+=length;
 
-	// Get integer potion
-	while(isdigit(c=CheckChar())) temp[pos++]=GetChar();
-
-	// Finish
-	temp[pos++]='\0';
 	return atoi(temp);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-// BUG: can't parse ".2", "f", or "F"
-// Uses: [-]I[.[I]][(e|E)[+|-]I]
-// Should use: [+|-](I|I.|.I|I.I)[(e|E)[+|-]I][f|F]
-
 float Tokenizer::GetFloat() {
 	SkipWhitespace();
-	int pos=0;
-	char temp[256];
 
-	// Get first character ('-' or digit)
-	char c=CheckChar();
-	if(c=='-') {
-		temp[pos++]=GetChar();
-		c=CheckChar();
-	}
-	if(!isdigit(c)) {
-		printf("ERROR: Tokenizer::GetFloat()- Expecting float on line %d of '%s' '%c'\n",LineNum,FileName,c);
+	char temp[64];
+	int length=ScanNumber(true);
+	if(length==0 || length>=int(sizeof(temp))) {
+		printf("ERROR: Tokenizer::GetFloat()- Expecting float on line %d of '%s' '%c'\n",LineNum,FileName.c_str(),CheckChar());
+		ErrorCount++;
 		return 0.0f;
 	}
-	temp[pos++]=GetChar();
+	memcpy(temp,Cursor,length);
+	temp[length]='\0';
+	Cursor+=length;
 
-	// Get integer potion of mantissa
-	while(isdigit(c=CheckChar())) temp[pos++]=GetChar();
+	// optional C style suffix
+	if(Cursor<End && (*Cursor=='f' || *Cursor=='F')) Cursor++;
 
-	// Get fraction component
-	if(c=='.') {
-		temp[pos++]=GetChar();
-		while(isdigit(c=CheckChar())) temp[pos++]=GetChar();
-	}
-
-	// Get exponent
-	if(c=='e' || c=='E') {
-		temp[pos++]=GetChar();
-		c=CheckChar();
-		if(c=='+' || c=='-') {
-			temp[pos++]=GetChar();
-			c=CheckChar();
-		}
-		if(!isdigit(c)) {
-			printf("ERROR: Tokenizer::GetFloat()- Poorly formatted float exponent on line %d of '%s'\n",LineNum,FileName);
-			return 0.0f;
-		}
-		while(isdigit(c=CheckChar())) temp[pos++]=GetChar();
-	}
-
-	// Finish
-	temp[pos++]='\0';
 	return float(atof(temp));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-bool Tokenizer::GetToken(char *str) {
+// Reads up to size-1 characters of the next token into str (the rest of a
+// longer token is skipped). Returns false if there was no token left.
+
+bool Tokenizer::GetToken(char *str,int size) {
 	SkipWhitespace();
 
 	int pos=0;
-	char c=CheckChar();
-	while(c!=' ' && c!='\n' && c!='\t' && c!='\r' && !feof((FILE*)File)) {
-		str[pos++]=GetChar();
-		c=CheckChar();
+	while(Cursor<End && !isspace((unsigned char)*Cursor)) {
+		if(pos<size-1) str[pos++]=*Cursor;
+		Cursor++;
 	}
 	str[pos]='\0';
-	return true;
+	return pos>0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -169,7 +175,7 @@ bool Tokenizer::GetToken(char *str) {
 bool Tokenizer::FindToken(const char *tok) {
 	int pos=0;
 	while(tok[pos]!='\0') {
-		if(feof((FILE*)File)) return false;
+		if(Cursor==End) return false;
 		char c=GetChar();
 		if(c==tok[pos]) pos++;
 		else pos=0;
@@ -180,11 +186,9 @@ bool Tokenizer::FindToken(const char *tok) {
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Tokenizer::SkipWhitespace() {
-	char c=CheckChar();
 	bool white=false;
-	while(isspace(c)) {
+	while(Cursor<End && isspace((unsigned char)*Cursor)) {
 		GetChar();
-		c=CheckChar();
 		white=true;
 	}
 	return white;
@@ -193,18 +197,19 @@ bool Tokenizer::SkipWhitespace() {
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Tokenizer::SkipLine() {
-	char c=GetChar();
-	while(c!='\n') {
-		if(feof((FILE*)File)) return false;
-		c=GetChar();
+	while(Cursor<End) {
+		if(GetChar()=='\n') return true;
 	}
-	return true;
+	return false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Tokenizer::Reset() {
-	if(fseek((FILE*)File,0,SEEK_SET)) return false;
+	if(!File.isOpen()) return false;
+	Cursor=(const char*)File.data();
+	LineNum=1;
+	ErrorCount=0;
 	return true;
 }
 
@@ -4,7 +4,9 @@
 
 #pragma once
 
-#include "core.h"
+#include "MappedFile.h"
+
+#include <string>
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -13,8 +15,11 @@
 // specifically parse integers and floating point numbers. SkipLine will skip to
 // the next carraige return. FindToken searches for a specific token and returns
 // true if it found it.
+//
+// The file is memory-mapped and read straight out of the mapping, so reading a
+// character is a pointer increment rather than a call into the C library.
 
-class Tokenizer 
+class Tokenizer
 {
 public:
 	Tokenizer();
@@ -23,27 +28,34 @@ public:
 	bool Open(const char *file);
 	bool Close();
 
-	bool Abort(char *error);	// Prints error & closes file, and always returns false
+	bool Abort(const char *error);	// Prints error & closes file, and always returns false
 
 	// Tokenization
 	char GetChar();
 	char CheckChar();
 	int GetInt();
 	float GetFloat();
-	bool GetToken(char *str);
+	bool GetToken(char *str,int size=256);
 	bool FindToken(const char *tok);
 	bool SkipWhitespace();
 	bool SkipLine();
 	bool Reset();
+	bool AtEnd()				{return Cursor==End;}
 
 	// Access functions
-	char *GetFileName()			{return FileName;}
+	const char *GetFileName()	{return FileName.c_str();}
 	int GetLineNum()			{return LineNum;}
+	int GetErrorCount()			{return ErrorCount;}	// ints/floats that couldn't be read
 
 private:
-	void *File;
-	char FileName[256];
+	MappedFile File;
+	const char *Cursor;			// next character
+	const char *End;			// one past the last character
+	std::string FileName;
 	int LineNum;
+	int ErrorCount;
+
+	int ScanNumber(bool fraction);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
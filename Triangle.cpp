@@ -1,10 +1,12 @@
 #include "Triangle.h"
 
+#include <algorithm>
+
 Triangle::Triangle(GLint index, GLfloat fluidDensity, GLfloat dragCoefficient,
-	glm::vec3* startingAirVelocity,
-	Particle* particle1, Particle* particle2, Particle* particle3) : index(index),
+	glm::vec3* startingAirVelocity, ParticleSystem* particles,
+	GLint particle1, GLint particle2, GLint particle3) : index(index),
 	fluidDensity(fluidDensity), dragCoefficient(dragCoefficient), 
-	P1(particle1), P2(particle2), P3(particle3){
+	particles(particles), P1(particle1), P2(particle2), P3(particle3){
 	this->airVelocity = startingAirVelocity;
 }
 
@@ -14,60 +16,104 @@ Triangle::~Triangle() {
 
 /*
 * Computes the aerodynamic drag force acting on this
-* triangle made up of three particles.
+* triangle made up of three particles. Returns the share of the
+* force that goes to each one of them.
 */
-void Triangle::ComputeForce() {
+glm::vec3 Triangle::EvaluateForce() {
 	// find velocity relative to airflow
-	glm::vec3 surfaceVelocity = (P1->getVelocity() + P2->getVelocity() + P3->getVelocity()) / 3.0f;
+	const std::vector<glm::vec3>& velocities = particles->velocities;
+	glm::vec3 surfaceVelocity = (velocities[P1] + velocities[P2] + velocities[P3]) / 3.0f;
 	glm::vec3 relVelocity = surfaceVelocity - *(this->airVelocity);
 
-	// find the normal of this triangle
-	glm::vec3 p1Top2 = P2->getPosition() - P1->getPosition();
-	glm::vec3 p1Top3 = P3->getPosition() - P1->getPosition();
+	// find the (unnormalized) normal of this triangle; its length is
+	// twice the triangle's area
+	glm::vec3 p1Top2 = getPos2() - getPos1();
+	glm::vec3 p1Top3 = getPos3() - getPos1();
 	glm::vec3 crossProduct = glm::cross(p1Top2, p1Top3);
-	glm::vec3 triangNormal = glm::normalize(crossProduct);
+	GLfloat crossLength = glm::length(crossProduct);
 
-	// find the cross-sectional area of triangle, as seen from airflow 
-	// direction
-	GLfloat triangArea = (0.5f) * glm::length(crossProduct);
-	GLfloat crossArea = triangArea * (glm::dot(relVelocity, triangNormal));
+	// the cross-sectional area as seen from airflow direction is
+	// area * dot(v, n) = 0.5 * dot(v, c), and the force acts along
+	// n = c / |c|, so only a single square root is needed
+	GLfloat crossArea = (0.5f) * glm::dot(relVelocity, crossProduct);
+	GLfloat relVelLengthSquared = glm::dot(relVelocity, relVelocity);
 
 	// find the final aerodynamic drag force
-	GLfloat relVelLengthSquared = glm::pow(glm::length(relVelocity), 2.0f);
-	glm::vec3 aeroForce = (-0.5f) * this->fluidDensity * relVelLengthSquared * 
-		this->dragCoefficient * crossArea * triangNormal;
-
-	// apply this force equally to all three particles
-	glm::vec3 forceThird = (1.0f / 3.0f) * aeroForce;
-	P1->ApplyForce(forceThird);
-	P2->ApplyForce(forceThird);
-	P3->ApplyForce(forceThird);
+	glm::vec3 aeroForce = ((-0.5f) * this->fluidDensity * relVelLengthSquared * 
+		this->dragCoefficient * crossArea / crossLength) * crossProduct;
+
+	// split this force equally to all three particles
+	return (1.0f / 3.0f) * aeroForce;
 }
 
-Particle* Triangle::getPar1() {
-	return P1;
+/*
+* Computes the aerodynamic drag force acting on this
+* triangle and applies it to its three particles.
+*/
+void Triangle::ComputeForce() {
+	glm::vec3 forceThird = EvaluateForce();
+	particles->ApplyForce(P1, forceThird);
+	particles->ApplyForce(P2, forceThird);
+	particles->ApplyForce(P3, forceThird);
 }
 
-Particle* Triangle::getPar2() {
-	return P2;
+/*
+* Same as SpringDamper::ColorTable, but for triangles: reorders them so no
+* two triangles of one color share a corner, letting each color's
+* aerodynamic forces be applied in parallel.
+* 
+* triangles: list to reorder
+* numParticles: number of particles the triangles index into
+* colorOffsets: filled with the start of each color, plus the list size
+*/
+void Triangle::ColorTriangles(std::vector<Triangle*>& triangles,
+	GLint numParticles, std::vector<GLint>& colorOffsets) {
+	// a particle touches at most 6 triangles, so 64 colors always suffice
+	std::vector<unsigned long long> usedColors(numParticles, 0);
+	std::vector<GLint> colors(triangles.size());
+	GLint numColors = 0;
+
+	for (size_t i = 0; i < triangles.size(); i++) {
+		Triangle* t = triangles[i];
+		unsigned long long used = usedColors[t->P1] | usedColors[t->P2] | usedColors[t->P3];
+		GLint color = 0;
+		while (used & (1ull << color)) color++;
+
+		colors[i] = color;
+		usedColors[t->P1] |= 1ull << color;
+		usedColors[t->P2] |= 1ull << color;
+		usedColors[t->P3] |= 1ull << color;
+		numColors = std::max(numColors, color + 1);
+	}
+
+	colorOffsets.assign(numColors + 1, 0);
+	for (GLint color : colors) colorOffsets[color + 1]++;
+	for (GLint c = 0; c < numColors; c++) colorOffsets[c + 1] += colorOffsets[c];
+
+	std::vector<Triangle*> colored(triangles.size());
+	std::vector<GLint> cursor(colorOffsets.begin(), colorOffsets.end() - 1);
+	for (size_t i = 0; i < triangles.size(); i++) {
+		colored[cursor[colors[i]]++] = triangles[i];
+	}
+	triangles.swap(colored);
 }
 
-Particle* Triangle::getPar3() {
-	return P3;
+GLint Triangle::getPar1() {
+	return P1;
 }
 
-void Triangle::computeNormal() {
-	glm::vec3 normal = getNormal();
+GLint Triangle::getPar2() {
+	return P2;
+}
 
-	P1->addNormal(normal);
-	P2->addNormal(normal);
-	P3->addNormal(normal);
+GLint Triangle::getPar3() {
+	return P3;
 }
 
 glm::vec3 Triangle::getNormal() {
 	// find the normal of this triangle
-	glm::vec3 p1Top2 = P2->getPosition() - P1->getPosition();
-	glm::vec3 p1Top3 = P3->getPosition() - P1->getPosition();
+	glm::vec3 p1Top2 = getPos2() - getPos1();
+	glm::vec3 p1Top3 = getPos3() - getPos1();
 	glm::vec3 crossProduct = glm::cross(p1Top2, p1Top3);
 	glm::vec3 triangNormal = glm::normalize(crossProduct);
 
@@ -75,13 +121,13 @@ glm::vec3 Triangle::getNormal() {
 }
 
 glm::vec3 Triangle::getPos1() {
-	return P1->getPosition();
+	return particles->positions[P1];
 }
 
 glm::vec3 Triangle::getPos2() {
-	return P2->getPosition();
+	return particles->positions[P2];
 }
 
 glm::vec3 Triangle::getPos3() {
-	return P3->getPosition();
+	return particles->positions[P3];
 }
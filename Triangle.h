@@ -1,6 +1,6 @@
 #pragma once
 
-#include "Particle.h"
+#include "ParticleSystem.h"
 
 class Triangle
 {
@@ -10,27 +10,32 @@ private:
 	glm::vec3* airVelocity;
 
 public:
-	// pointers to each particle
-	Particle *P1, *P2, *P3;
+	// store holding the corners, and their indices into it
+	ParticleSystem* particles;
+	GLint P1, P2, P3;
 
 	GLint index;	// keeps track of which Triangle this is
 
 	Triangle(GLint index, GLfloat fluidDensity, GLfloat dragCoefficient,
-		glm::vec3* startingAirVelocity,
-		Particle* particle1, Particle* particle2, Particle* particle3);
+		glm::vec3* startingAirVelocity, ParticleSystem* particles,
+		GLint particle1, GLint particle2, GLint particle3);
 	~Triangle();
 
+	glm::vec3 EvaluateForce();
 	void ComputeForce();
 
-	Particle* getPar1();
-	Particle* getPar2();
-	Particle* getPar3();
+	GLfloat getFluidDensity() const { return fluidDensity; }
+	GLfloat getDragCoefficient() const { return dragCoefficient; }
 
-	void computeNormal();
+	static void ColorTriangles(std::vector<Triangle*>& triangles, 
+		GLint numParticles, std::vector<GLint>& colorOffsets);
+
+	GLint getPar1();
+	GLint getPar2();
+	GLint getPar3();
 
 	glm::vec3 getNormal();
 	glm::vec3 getPos1();
 	glm::vec3 getPos2();
 	glm::vec3 getPos3();
 };
-
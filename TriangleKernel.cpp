@@ -0,0 +1,316 @@
+#include "TriangleKernel.h"
+
+#include "CpuFeatures.h"
+
+#ifdef CLOTH_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// raw pointers for one Evaluate call, shared by every kernel version
+struct TriangleBatch
+{
+	const GLint *p1, *p2, *p3;
+	const GLfloat* dragScale;
+	const GLfloat *pos, *vel;
+	GLfloat airX, airY, airZ;
+	GLfloat *fx, *fy, *fz;
+	GLfloat *nx, *ny, *nz;
+};
+
+typedef void (*TriangleBatchFunc)(const TriangleBatch& b, GLint begin, GLint end);
+
+/*
+* Reference version, same math as Triangle::EvaluateForce. With c the
+* cross product of two edges, the corner force is
+* dragScale * |v|^2 * dot(v, c) / |c| * c.
+*/
+static void EvaluateScalar(const TriangleBatch& b, GLint begin, GLint end) {
+	const GLfloat third = 1.0f / 3.0f;
+
+	for (GLint i = begin; i < end; i++) {
+		const GLfloat* x1 = b.pos + 3 * b.p1[i];
+		const GLfloat* x2 = b.pos + 3 * b.p2[i];
+		const GLfloat* x3 = b.pos + 3 * b.p3[i];
+		const GLfloat* v1 = b.vel + 3 * b.p1[i];
+		const GLfloat* v2 = b.vel + 3 * b.p2[i];
+		const GLfloat* v3 = b.vel + 3 * b.p3[i];
+
+		// velocity relative to airflow
+		GLfloat vx = (v1[0] + v2[0] + v3[0]) * third - b.airX;
+		GLfloat vy = (v1[1] + v2[1] + v3[1]) * third - b.airY;
+		GLfloat vz = (v1[2] + v2[2] + v3[2]) * third - b.airZ;
+
+		// area-weighted normal
+		GLfloat ax = x2[0] - x1[0], ay = x2[1] - x1[1], az = x2[2] - x1[2];
+		GLfloat bx = x3[0] - x1[0], by = x3[1] - x1[1], bz = x3[2] - x1[2];
+		GLfloat cx = ay * bz - az * by;
+		GLfloat cy = az * bx - ax * bz;
+		GLfloat cz = ax * by - ay * bx;
+		GLfloat invLength = 1.0f / std::sqrt(cx * cx + cy * cy + cz * cz);
+
+		GLfloat speedSq = vx * vx + vy * vy + vz * vz;
+		GLfloat flux = vx * cx + vy * cy + vz * cz;
+		GLfloat scale = b.dragScale[i] * speedSq * flux * invLength;
+
+		b.fx[i] = scale * cx;
+		b.fy[i] = scale * cy;
+		b.fz[i] = scale * cz;
+		b.nx[i] = cx * invLength;
+		b.ny[i] = cy * invLength;
+		b.nz[i] = cz * invLength;
+	}
+}
+
+#ifdef CLOTH_X86_SIMD
+
+/*
+* 8 triangles per iteration, corners fetched with gathers.
+*/
+CLOTH_TARGET_AVX2 static void EvaluateAVX2(const TriangleBatch& b, GLint begin, GLint end) {
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 third = _mm256_set1_ps(1.0f / 3.0f);
+	const __m256 airX = _mm256_set1_ps(b.airX);
+	const __m256 airY = _mm256_set1_ps(b.airY);
+	const __m256 airZ = _mm256_set1_ps(b.airZ);
+	GLint i = begin;
+
+	for (; i + 8 <= end; i += 8) {
+		// particle indices to float offsets (3 floats per particle)
+		__m256i i1 = _mm256_loadu_si256((const __m256i*)(b.p1 + i));
+		__m256i i2 = _mm256_loadu_si256((const __m256i*)(b.p2 + i));
+		__m256i i3 = _mm256_loadu_si256((const __m256i*)(b.p3 + i));
+		i1 = _mm256_add_epi32(i1, _mm256_add_epi32(i1, i1));
+		i2 = _mm256_add_epi32(i2, _mm256_add_epi32(i2, i2));
+		i3 = _mm256_add_epi32(i3, _mm256_add_epi32(i3, i3));
+
+		// velocity relative to airflow
+		__m256 vx = _mm256_add_ps(_mm256_i32gather_ps(b.vel, i1, 4),
+			_mm256_add_ps(_mm256_i32gather_ps(b.vel, i2, 4), _mm256_i32gather_ps(b.vel, i3, 4)));
+		__m256 vy = _mm256_add_ps(_mm256_i32gather_ps(b.vel + 1, i1, 4),
+			_mm256_add_ps(_mm256_i32gather_ps(b.vel + 1, i2, 4), _mm256_i32gather_ps(b.vel + 1, i3, 4)));
+		__m256 vz = _mm256_add_ps(_mm256_i32gather_ps(b.vel + 2, i1, 4),
+			_mm256_add_ps(_mm256_i32gather_ps(b.vel + 2, i2, 4), _mm256_i32gather_ps(b.vel + 2, i3, 4)));
+		vx = _mm256_sub_ps(_mm256_mul_ps(vx, third), airX);
+		vy = _mm256_sub_ps(_mm256_mul_ps(vy, third), airY);
+		vz = _mm256_sub_ps(_mm256_mul_ps(vz, third), airZ);
+
+		// area-weighted normal
+		__m256 x1 = _mm256_i32gather_ps(b.pos, i1, 4);
+		__m256 y1 = _mm256_i32gather_ps(b.pos + 1, i1, 4);
+		__m256 z1 = _mm256_i32gather_ps(b.pos + 2, i1, 4);
+		__m256 ax = _mm256_sub_ps(_mm256_i32gather_ps(b.pos, i2, 4), x1);
+		__m256 ay = _mm256_sub_ps(_mm256_i32gather_ps(b.pos + 1, i2, 4), y1);
+		__m256 az = _mm256_sub_ps(_mm256_i32gather_ps(b.pos + 2, i2, 4), z1);
+		__m256 bx = _mm256_sub_ps(_mm256_i32gather_ps(b.pos, i3, 4), x1);
+		__m256 by = _mm256_sub_ps(_mm256_i32gather_ps(b.pos + 1, i3, 4), y1);
+		__m256 bz = _mm256_sub_ps(_mm256_i32gather_ps(b.pos + 2, i3, 4), z1);
+		__m256 cx = _mm256_sub_ps(_mm256_mul_ps(ay, bz), _mm256_mul_ps(az, by));
+		__m256 cy = _mm256_sub_ps(_mm256_mul_ps(az, bx), _mm256_mul_ps(ax, bz));
+		__m256 cz = _mm256_sub_ps(_mm256_mul_ps(ax, by), _mm256_mul_ps(ay, bx));
+		__m256 lengthSq = _mm256_add_ps(_mm256_mul_ps(cx, cx),
+			_mm256_add_ps(_mm256_mul_ps(cy, cy), _mm256_mul_ps(cz, cz)));
+		__m256 invLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSq));
+
+		__m256 speedSq = _mm256_add_ps(_mm256_mul_ps(vx, vx),
+			_mm256_add_ps(_mm256_mul_ps(vy, vy), _mm256_mul_ps(vz, vz)));
+		__m256 flux = _mm256_add_ps(_mm256_mul_ps(vx, cx),
+			_mm256_add_ps(_mm256_mul_ps(vy, cy), _mm256_mul_ps(vz, cz)));
+		__m256 scale = _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(b.dragScale + i), speedSq),
+			_mm256_mul_ps(flux, invLength));
+
+		_mm256_storeu_ps(b.fx + i, _mm256_mul_ps(scale, cx));
+		_mm256_storeu_ps(b.fy + i, _mm256_mul_ps(scale, cy));
+		_mm256_storeu_ps(b.fz + i, _mm256_mul_ps(scale, cz));
+		_mm256_storeu_ps(b.nx + i, _mm256_mul_ps(cx, invLength));
+		_mm256_storeu_ps(b.ny + i, _mm256_mul_ps(cy, invLength));
+		_mm256_storeu_ps(b.nz + i, _mm256_mul_ps(cz, invLength));
+	}
+
+	EvaluateScalar(b, i, end);
+}
+
+/*
+* Same as EvaluateAVX2 with 16 triangles per iteration.
+*/
+CLOTH_TARGET_AVX512 static void EvaluateAVX512(const TriangleBatch& b, GLint begin, GLint end) {
+	const __m512 one = _mm512_set1_ps(1.0f);
+	const __m512 third = _mm512_set1_ps(1.0f / 3.0f);
+	const __m512 airX = _mm512_set1_ps(b.airX);
+	const __m512 airY = _mm512_set1_ps(b.airY);
+	const __m512 airZ = _mm512_set1_ps(b.airZ);
+	GLint i = begin;
+
+	for (; i + 16 <= end; i += 16) {
+		// particle indices to float offsets (3 floats per particle)
+		__m512i i1 = _mm512_loadu_si512((const void*)(b.p1 + i));
+		__m512i i2 = _mm512_loadu_si512((const void*)(b.p2 + i));
+		__m512i i3 = _mm512_loadu_si512((const void*)(b.p3 + i));
+		i1 = _mm512_add_epi32(i1, _mm512_add_epi32(i1, i1));
+		i2 = _mm512_add_epi32(i2, _mm512_add_epi32(i2, i2));
+		i3 = _mm512_add_epi32(i3, _mm512_add_epi32(i3, i3));
+
+		// velocity relative to airflow
+		__m512 vx = _mm512_add_ps(_mm512_i32gather_ps(i1, b.vel, 4),
+			_mm512_add_ps(_mm512_i32gather_ps(i2, b.vel, 4), _mm512_i32gather_ps(i3, b.vel, 4)));
+		__m512 vy = _mm512_add_ps(_mm512_i32gather_ps(i1, b.vel + 1, 4),
+			_mm512_add_ps(_mm512_i32gather_ps(i2, b.vel + 1, 4), _mm512_i32gather_ps(i3, b.vel + 1, 4)));
+		__m512 vz = _mm512_add_ps(_mm512_i32gather_ps(i1, b.vel + 2, 4),
+			_mm512_add_ps(_mm512_i32gather_ps(i2, b.vel + 2, 4), _mm512_i32gather_ps(i3, b.vel + 2, 4)));
+		vx = _mm512_sub_ps(_mm512_mul_ps(vx, third), airX);
+		vy = _mm512_sub_ps(_mm512_mul_ps(vy, third), airY);
+		vz = _mm512_sub_ps(_mm512_mul_ps(vz, third), airZ);
+
+		// area-weighted normal
+		__m512 x1 = _mm512_i32gather_ps(i1, b.pos, 4);
+		__m512 y1 = _mm512_i32gather_ps(i1, b.pos + 1, 4);
+		__m512 z1 = _mm512_i32gather_ps(i1, b.pos + 2, 4);
+		__m512 ax = _mm512_sub_ps(_mm512_i32gather_ps(i2, b.pos, 4), x1);
+		__m512 ay = _mm512_sub_ps(_mm512_i32gather_ps(i2, b.pos + 1, 4), y1);
+		__m512 az = _mm512_sub_ps(_mm512_i32gather_ps(i2, b.pos + 2, 4), z1);
+		__m512 bx = _mm512_sub_ps(_mm512_i32gather_ps(i3, b.pos, 4), x1);
+		__m512 by = _mm512_sub_ps(_mm512_i32gather_ps(i3, b.pos + 1, 4), y1);
+		__m512 bz = _mm512_sub_ps(_mm512_i32gather_ps(i3, b.pos + 2, 4), z1);
+		__m512 cx = _mm512_sub_ps(_mm512_mul_ps(ay, bz), _mm512_mul_ps(az, by));
+		__m512 cy = _mm512_sub_ps(_mm512_mul_ps(az, bx), _mm512_mul_ps(ax, bz));
+		__m512 cz = _mm512_sub_ps(_mm512_mul_ps(ax, by), _mm512_mul_ps(ay, bx));
+		__m512 lengthSq = _mm512_add_ps(_mm512_mul_ps(cx, cx),
+			_mm512_add_ps(_mm512_mul_ps(cy, cy), _mm512_mul_ps(cz, cz)));
+		__m512 invLength = _mm512_div_ps(one, _mm512_sqrt_ps(lengthSq));
+
+		__m512 speedSq = _mm512_add_ps(_mm512_mul_ps(vx, vx),
+			_mm512_add_ps(_mm512_mul_ps(vy, vy), _mm512_mul_ps(vz, vz)));
+		__m512 flux = _mm512_add_ps(_mm512_mul_ps(vx, cx),
+			_mm512_add_ps(_mm512_mul_ps(vy, cy), _mm512_mul_ps(vz, cz)));
+		__m512 scale = _mm512_mul_ps(_mm512_mul_ps(_mm512_loadu_ps(b.dragScale + i), speedSq),
+			_mm512_mul_ps(flux, invLength));
+
+		_mm512_storeu_ps(b.fx + i, _mm512_mul_ps(scale, cx));
+		_mm512_storeu_ps(b.fy + i, _mm512_mul_ps(scale, cy));
+		_mm512_storeu_ps(b.fz + i, _mm512_mul_ps(scale, cz));
+		_mm512_storeu_ps(b.nx + i, _mm512_mul_ps(cx, invLength));
+		_mm512_storeu_ps(b.ny + i, _mm512_mul_ps(cy, invLength));
+		_mm512_storeu_ps(b.nz + i, _mm512_mul_ps(cz, invLength));
+	}
+
+	EvaluateAVX2(b, i, end);
+}
+
+#endif
+
+static const char* kernelName = "scalar";
+
+/*
+* Picks the widest kernel this CPU can run.
+*/
+static TriangleBatchFunc SelectKernel() {
+#ifdef CLOTH_X86_SIMD
+	if (CpuFeatures::HasAVX512()) {
+		kernelName = "AVX-512";
+		return EvaluateAVX512;
+	}
+	if (CpuFeatures::HasAVX2()) {
+		kernelName = "AVX2";
+		return EvaluateAVX2;
+	}
+#endif
+	return EvaluateScalar;
+}
+
+// selected on first use, not during static initialization
+static TriangleBatchFunc GetKernel() {
+	static const TriangleBatchFunc kernel = SelectKernel();
+	return kernel;
+}
+
+/*
+* Copies a triangle list into the kernel's own arrays. Has to be called
+* again whenever the list changes.
+* 
+* triangles: triangle list to mirror
+*/
+void TriangleKernel::Build(const std::vector<Triangle*>& triangles) {
+	size_t count = triangles.size();
+	P1.resize(count);
+	P2.resize(count);
+	P3.resize(count);
+	dragScale.resize(count);
+
+	for (size_t i = 0; i < count; i++) {
+		const Triangle* t = triangles[i];
+		P1[i] = t->P1;
+		P2[i] = t->P2;
+		P3[i] = t->P3;
+		// -0.5 rho Cd from the drag equation, 0.5 from the cross-sectional
+		// area and 1/3 for the share of each corner
+		dragScale[i] = -t->getFluidDensity() * t->getDragCoefficient() / 12.0f;
+	}
+
+	forceX.assign(count, 0.0f);
+	forceY.assign(count, 0.0f);
+	forceZ.assign(count, 0.0f);
+	normalX.assign(count, 0.0f);
+	normalY.assign(count, 0.0f);
+	normalZ.assign(count, 0.0f);
+}
+
+/*
+* Evaluates the drag and normal of triangles [begin, end). Different
+* ranges can be evaluated from different threads.
+* 
+* particles: store the triangles index into
+* airVelocity: velocity of the surrounding air
+*/
+void TriangleKernel::Evaluate(const ParticleSystem& particles, 
+	const glm::vec3& airVelocity, GLint begin, GLint end) {
+	TriangleBatch b;
+	b.p1 = P1.data();
+	b.p2 = P2.data();
+	b.p3 = P3.data();
+	b.dragScale = dragScale.data();
+	b.pos = (const GLfloat*)particles.positions.data();
+	b.vel = (const GLfloat*)particles.velocities.data();
+	b.airX = airVelocity.x;
+	b.airY = airVelocity.y;
+	b.airZ = airVelocity.z;
+	b.fx = forceX.data();
+	b.fy = forceY.data();
+	b.fz = forceZ.data();
+	b.nx = normalX.data();
+	b.ny = normalY.data();
+	b.nz = normalZ.data();
+
+	GetKernel()(b, begin, end);
+}
+
+/*
+* Only the normal part of Evaluate: the unit normal of triangles
+* [begin, end), with the same math, for when no force is needed.
+* Different ranges can be evaluated from different threads.
+* 
+* particles: store the triangles index into
+*/
+void TriangleKernel::EvaluateNormals(const ParticleSystem& particles, GLint begin, GLint end) {
+	const GLfloat* pos = (const GLfloat*)particles.positions.data();
+
+	for (GLint i = begin; i < end; i++) {
+		const GLfloat* x1 = pos + 3 * P1[i];
+		const GLfloat* x2 = pos + 3 * P2[i];
+		const GLfloat* x3 = pos + 3 * P3[i];
+
+		GLfloat ax = x2[0] - x1[0], ay = x2[1] - x1[1], az = x2[2] - x1[2];
+		GLfloat bx = x3[0] - x1[0], by = x3[1] - x1[1], bz = x3[2] - x1[2];
+		GLfloat cx = ay * bz - az * by;
+		GLfloat cy = az * bx - ax * bz;
+		GLfloat cz = ax * by - ay * bx;
+		GLfloat invLength = 1.0f / std::sqrt(cx * cx + cy * cy + cz * cz);
+
+		normalX[i] = cx * invLength;
+		normalY[i] = cy * invLength;
+		normalZ[i] = cz * invLength;
+	}
+}
+
+const char* TriangleKernel::InstructionSet() {
+	GetKernel();
+	return kernelName;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Triangle.h"
+
+/*
+* Flat copy of a triangle list together with a SIMD kernel for their
+* aerodynamic drag. Besides the force share of each corner it also
+* leaves every triangle's unit normal behind. Like SpringKernel, the
+* widest version the CPU supports is picked at runtime.
+*/
+class TriangleKernel
+{
+public:
+	// corner indices of each triangle, in list order
+	std::vector<GLint> P1, P2, P3;
+	// -fluidDensity * dragCoefficient / 12 folded into one constant
+	std::vector<GLfloat> dragScale;
+
+	// output: force on each corner, and unit normal of each triangle
+	std::vector<GLfloat> forceX, forceY, forceZ;
+	std::vector<GLfloat> normalX, normalY, normalZ;
+
+	void Build(const std::vector<Triangle*>& triangles);
+	GLint size() const { return (GLint)P1.size(); }
+
+	void Evaluate(const ParticleSystem& particles, const glm::vec3& airVelocity,
+		GLint begin, GLint end);
+	void EvaluateNormals(const ParticleSystem& particles, GLint begin, GLint end);
+	glm::vec3 getForce(GLint i) const { return glm::vec3(forceX[i], forceY[i], forceZ[i]); }
+	glm::vec3 getNormal(GLint i) const { return glm::vec3(normalX[i], normalY[i], normalZ[i]); }
+
+	// name of the instruction set Evaluate runs on
+	static const char* InstructionSet();
+};
@@ -0,0 +1,147 @@
+#include "VertexCache.h"
+
+#include <cstring>
+
+const char VertexCache::magic[8] = { 'C', 'L', 'T', 'H', 'V', 'C', 'A', 'C' };
+
+VertexCache::VertexCache() {
+	this->frame = -1;
+	this->chunk = -1;
+	this->cursor = nullptr;
+}
+
+/*
+* Maps a vertex cache and checks that its header, chunk table and
+* triangle indices make sense.
+*
+* path: file written by VertexCacheWriter
+* returns: false if it can't be played back here; the cache is closed then
+*/
+bool VertexCache::Open(const std::string& path) {
+	this->Close();
+	if (!file.Open(path)) return false;
+
+	bool ok = file.size() >= sizeof(Header);
+	if (ok) {
+		const Header& header = this->getHeader();
+		unsigned long long tableSize = sizeof(unsigned long long) * ((unsigned long long)header.numChunks + 1);
+		ok = memcmp(header.magic, magic, sizeof(magic)) == 0 &&
+			header.version == version && header.byteOrder == byteOrderMark &&
+			header.fileSize == file.size() &&
+			header.numVertices > 0 && header.numIndices >= 0 && header.numFrames > 0 &&
+			header.framesPerChunk > 0 && header.frameTime > 0.0f &&
+			header.numChunks == (header.numFrames + header.framesPerChunk - 1) / header.framesPerChunk &&
+			header.indicesOffset >= sizeof(Header) && header.indicesOffset % sizeof(unsigned int) == 0 &&
+			header.indicesOffset + sizeof(unsigned int) * (unsigned long long)header.numIndices <= header.fileSize &&
+			header.chunkTableOffset % sizeof(unsigned long long) == 0 &&
+			header.chunkTableOffset + tableSize <= header.fileSize;
+
+		// chunks follow each other, each at least its header long
+		for (GLint c = 0; c < header.numChunks && ok; c++) {
+			unsigned long long start = this->getChunkTable()[c], end = this->getChunkTable()[c + 1];
+			ok = start >= sizeof(Header) && start % sizeof(unsigned long long) == 0 &&
+				start + sizeof(ChunkHeader) <= end && end <= header.fileSize &&
+				this->getChunk(c).firstFrame == c * header.framesPerChunk;
+		}
+		for (GLint i = 0; i < header.numIndices && ok; i++) {
+			ok = this->getIndices()[i] < (unsigned int)header.numVertices;
+		}
+	}
+
+	if (!ok) file.Close();
+	return ok;
+}
+
+void VertexCache::Close() {
+	file.Close();
+	this->frame = -1;
+	this->chunk = -1;
+	this->cursor = nullptr;
+}
+
+/*
+* Decodes one frame of an open cache.
+*
+* frame: which one, clamped to the frames there are
+* out: room for getNumVertices() vertices (e.g. a mapped GL buffer)
+* offset, scale: set to the box the positions are quantized in, as for
+* PackedVertex::Pack
+*/
+void VertexCache::Decode(GLint frame, PackedVertex* out, glm::vec3& offset, glm::vec3& scale) {
+	const Header& header = this->getHeader();
+	GLint target = glm::clamp(frame, 0, header.numFrames - 1);
+	GLint targetChunk = target / header.framesPerChunk;
+	GLint numVertices = header.numVertices;
+	GLint numValues = (header.normals ? 6 : 3) * numVertices;
+
+	// start over from the chunk's first frame unless on the way there
+	if (targetChunk != this->chunk || target < this->frame) {
+		values.assign(numValues, 0);
+		this->chunk = targetChunk;
+		this->frame = this->getChunk(targetChunk).firstFrame - 1;
+		this->cursor = file.data() + this->getChunkTable()[targetChunk] + sizeof(ChunkHeader);
+	}
+
+	const unsigned char* end = file.data() + this->getChunkTable()[targetChunk + 1];
+	for (; this->frame < target; this->frame++) {
+		for (GLint i = 0; i < numValues; i++) {
+			GLint delta;
+			cursor = GetDelta(cursor, end, delta);
+			values[i] += delta;
+		}
+	}
+
+	const ChunkHeader& chunkHeader = this->getChunk(targetChunk);
+	offset = glm::vec3(chunkHeader.offset[0], chunkHeader.offset[1], chunkHeader.offset[2]);
+	scale = glm::vec3(chunkHeader.scale[0], chunkHeader.scale[1], chunkHeader.scale[2]);
+
+	const GLint* position = values.data();
+	for (GLint v = 0; v < numVertices; v++, position += 3) {
+		out[v].position[0] = (GLshort)position[0];
+		out[v].position[1] = (GLshort)position[1];
+		out[v].position[2] = (GLshort)position[2];
+		out[v].position[3] = 0;
+	}
+
+	if (!header.normals) {
+		this->ComputeNormals(chunkHeader, out);
+		return;
+	}
+
+	// back into the 10-bit fields they came from
+	const GLint* normal = values.data() + 3 * numVertices;
+	for (GLint v = 0; v < numVertices; v++, normal += 3) {
+		out[v].normal = ((GLuint)normal[0] & 0x3FFu) | (((GLuint)normal[1] & 0x3FFu) << 10) |
+			(((GLuint)normal[2] & 0x3FFu) << 20);
+	}
+}
+
+/*
+* Area weighted vertex normals from the decoded positions and the cache's
+* triangles, for files written without normals.
+*/
+void VertexCache::ComputeNormals(const ChunkHeader& chunk, PackedVertex* out) {
+	GLint numVertices = this->getHeader().numVertices;
+	glm::vec3 offset(chunk.offset[0], chunk.offset[1], chunk.offset[2]);
+	glm::vec3 scale = glm::vec3(chunk.scale[0], chunk.scale[1], chunk.scale[2]) / 32767.0f;
+
+	positions.resize(numVertices);
+	for (GLint v = 0; v < numVertices; v++) {
+		positions[v] = offset + scale * glm::vec3(values[3 * v], values[3 * v + 1], values[3 * v + 2]);
+	}
+
+	normals.assign(numVertices, glm::vec3(0.0f));
+	const unsigned int* indices = this->getIndices();
+	for (GLint i = 0; i + 2 < this->getHeader().numIndices; i += 3) {
+		unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		glm::vec3 n = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+		normals[a] += n;
+		normals[b] += n;
+		normals[c] += n;
+	}
+
+	for (GLint v = 0; v < numVertices; v++) {
+		GLfloat length = glm::length(normals[v]);
+		out[v].normal = PackedVertex::PackNormal(length > 0.0f ? normals[v] / length : normals[v]);
+	}
+}
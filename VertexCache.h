@@ -0,0 +1,118 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "PackedVertex.h"
+
+#include <string>
+
+/*
+* Baked cloth animation, as written by VertexCacheWriter, played back
+* straight out of a memory-mapped file.
+*
+* Frames are grouped into chunks. Every chunk quantizes its positions to
+* signed 16-bit values within the box around all of its frames (the same
+* encoding PackedVertex uses), and normals, if stored, to the 10-bit
+* fields of PackedVertex::PackNormal. Each frame is then stored as the
+* difference of every quantized value from the frame before it (from zero
+* for the first frame of a chunk), as zigzag varints: cloth moves little
+* from frame to frame, so most differences take a single byte. Decoding
+* is exact, the quantization is the only loss.
+*
+* Decode writes a frame as PackedVertex, so it can go directly into a
+* mapped vertex buffer. Playing forward only decodes one frame's
+* differences per call; jumping to a frame decodes its chunk from the
+* start.
+*/
+class VertexCache
+{
+public:
+	static const unsigned int version = 1;
+
+	struct Header {
+		char magic[8];
+		unsigned int version;
+		unsigned int byteOrder;			// byteOrderMark in the writer's byte order
+		GLint numVertices;
+		GLint numIndices;
+		GLint numFrames;				// 0 until the writer is closed
+		GLint numChunks;
+		GLint framesPerChunk;
+		GLint normals;					// 1 if normals are stored
+		GLfloat frameTime;				// seconds between frames
+		GLint padding;
+		unsigned long long indicesOffset;		// numIndices unsigned ints
+		unsigned long long chunkTableOffset;	// numChunks + 1 chunk offsets
+		unsigned long long fileSize;
+	};
+
+	// starts every chunk, followed by the frames' differences
+	struct ChunkHeader {
+		GLfloat offset[3], scale[3];	// quantization box, as in PackedVertex
+		GLint firstFrame, numFrames;
+	};
+
+	static const char magic[8];		// "CLTHVCAC"
+	static const unsigned int byteOrderMark = 0x01020304;
+
+	VertexCache();
+
+	bool Open(const std::string& path);
+	void Close();
+	bool isOpen() const { return file.isOpen(); }
+
+	GLint getNumVertices() const { return this->getHeader().numVertices; }
+	GLint getNumFrames() const { return this->getHeader().numFrames; }
+	GLfloat getFrameTime() const { return this->getHeader().frameTime; }
+	bool hasNormals() const { return this->getHeader().normals != 0; }
+	GLint getNumIndices() const { return this->getHeader().numIndices; }
+	const unsigned int* getIndices() const {
+		return (const unsigned int*)(file.data() + this->getHeader().indicesOffset);
+	}
+
+	void Decode(GLint frame, PackedVertex* out, glm::vec3& offset, glm::vec3& scale);
+
+	// zigzag varint coding of one difference
+	static unsigned char* PutDelta(GLint delta, unsigned char* out) {
+		GLuint value = ((GLuint)delta << 1) ^ (GLuint)(delta >> 31);
+		while (value >= 0x80) {
+			*out++ = (unsigned char)(value | 0x80);
+			value >>= 7;
+		}
+		*out++ = (unsigned char)value;
+		return out;
+	}
+	static const unsigned char* GetDelta(const unsigned char* in, const unsigned char* end,
+		GLint& delta) {
+		GLuint value = 0;
+		for (int shift = 0; in < end && shift < 35; shift += 7) {
+			unsigned char byte = *in++;
+			value |= (GLuint)(byte & 0x7F) << shift;
+			if (!(byte & 0x80)) break;
+		}
+		delta = (GLint)(value >> 1) ^ -(GLint)(value & 1);
+		return in;
+	}
+
+private:
+	MappedFile file;
+
+	// quantized values of the last decoded frame, 3 per vertex for the
+	// positions then 3 per vertex for the normals
+	std::vector<GLint> values;
+	GLint frame;					// last decoded frame, -1 for none
+	GLint chunk;					// chunk it is in
+	const unsigned char* cursor;	// differences of the frame after it
+
+	// normals rebuilt from the positions when the file has none
+	std::vector<glm::vec3> positions, normals;
+
+	const Header& getHeader() const { return *(const Header*)file.data(); }
+	const unsigned long long* getChunkTable() const {
+		return (const unsigned long long*)(file.data() + this->getHeader().chunkTableOffset);
+	}
+	const ChunkHeader& getChunk(GLint index) const {
+		return *(const ChunkHeader*)(file.data() + this->getChunkTable()[index]);
+	}
+
+	void ComputeNormals(const ChunkHeader& chunk, PackedVertex* out);
+};
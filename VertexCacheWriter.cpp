@@ -0,0 +1,246 @@
+#include "VertexCacheWriter.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+// chunks and the chunk table start on boundaries this size
+static const unsigned long long chunkAlignment = 8;
+
+VertexCacheWriter::VertexCacheWriter() {
+	this->file = nullptr;
+	this->failed = false;
+	this->closing = false;
+	this->position = 0;
+	memset(&header, 0, sizeof(header));
+}
+
+VertexCacheWriter::~VertexCacheWriter() {
+	this->Close();
+}
+
+/*
+* Starts a new cache file and the thread writing it, closing the one
+* being written before.
+*
+* path: file to (over)write
+* numVertices: vertices in every frame
+* indices: three vertex indices per triangle, stored for playback
+* frameTime: seconds between two frames
+* withNormals: store the normals too, instead of having playback
+* recompute them
+* framesPerChunk: frames quantized in the same box; jumping to a frame
+* decodes up to this many
+* returns: false if the file couldn't be created
+*/
+bool VertexCacheWriter::Open(const std::string& path, GLint numVertices,
+	const std::vector<unsigned int>& indices, GLfloat frameTime, bool withNormals,
+	GLint framesPerChunk) {
+	this->Close();
+
+	this->file = fopen(path.c_str(), "wb");
+	if (!file) return false;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, VertexCache::magic, sizeof(header.magic));
+	header.version = VertexCache::version;
+	header.byteOrder = VertexCache::byteOrderMark;
+	header.numVertices = numVertices;
+	header.numIndices = (GLint)indices.size();
+	header.framesPerChunk = glm::max(framesPerChunk, 1);
+	header.normals = withNormals ? 1 : 0;
+	header.frameTime = frameTime;
+	header.indicesOffset = sizeof(header);
+
+	// the header is written again with the final counts on Close
+	this->failed = false;
+	this->position = 0;
+	this->Write(&header, sizeof(header));
+	this->Write(indices.data(), sizeof(unsigned int) * indices.size());
+
+	this->closing = false;
+	thread = std::thread(&VertexCacheWriter::Run, this);
+	return true;
+}
+
+/*
+* Queues one frame to be written. Only copies it, the writing happens on
+* the background thread.
+*
+* positions: one per vertex
+* normals: one per vertex, only read if the cache stores normals
+*/
+void VertexCacheWriter::AddFrame(const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals) {
+	if (!file) return;
+
+	Frame frame;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!spare.empty()) {
+			frame = std::move(spare.back());
+			spare.pop_back();
+		}
+	}
+
+	frame.positions.assign(positions.begin(), positions.begin() + header.numVertices);
+	if (header.normals) {
+		frame.normals.assign(normals.begin(), normals.begin() + header.numVertices);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queued.push_back(std::move(frame));
+	}
+	wake.notify_one();
+}
+
+/*
+* Writes whatever frames are still queued, then the chunk table and the
+* final header, and closes the file.
+*
+* returns: false if any of the file couldn't be written
+*/
+bool VertexCacheWriter::Close() {
+	if (!file) return false;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->closing = true;
+	}
+	wake.notify_one();
+	thread.join();
+
+	// one more offset marks where the last chunk ends
+	this->Align();
+	chunkOffsets.push_back(position);
+	header.chunkTableOffset = position;
+	this->Write(chunkOffsets.data(), sizeof(unsigned long long) * chunkOffsets.size());
+	header.fileSize = position;
+
+	bool ok = !failed && fseek(file, 0, SEEK_SET) == 0 &&
+		fwrite(&header, sizeof(header), 1, file) == 1;
+	ok = fclose(file) == 0 && ok;
+
+	this->file = nullptr;
+	chunkOffsets.clear();
+	queued.clear();
+	spare.clear();
+	return ok;
+}
+
+/*
+* Background thread: collects queued frames into chunks and writes each
+* chunk once it is full, and the last one when closing.
+*/
+void VertexCacheWriter::Run() {
+	std::vector<Frame> batch;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return closing || !queued.empty(); });
+			if (queued.empty()) break;
+			batch.swap(queued);
+		}
+
+		for (Frame& frame : batch) {
+			chunkFrames.push_back(std::move(frame));
+			if ((GLint)chunkFrames.size() == header.framesPerChunk) this->WriteChunk();
+		}
+		batch.clear();
+	}
+
+	if (!chunkFrames.empty()) this->WriteChunk();
+}
+
+/*
+* Quantizes and delta codes the collected frames as one chunk, then hands
+* their buffers back to AddFrame.
+*/
+void VertexCacheWriter::WriteChunk() {
+	GLint numVertices = header.numVertices;
+	GLint numFrames = (GLint)chunkFrames.size();
+
+	// box around every frame of the chunk, as PackedVertex::ComputeBounds;
+	// positions that blew up are left out and stored at its center
+	glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+	for (const Frame& frame : chunkFrames) {
+		for (const glm::vec3& p : frame.positions) {
+			if (!std::isfinite(glm::dot(p, p))) continue;
+			low = glm::min(low, p);
+			high = glm::max(high, p);
+		}
+	}
+	if (low.x > high.x) low = high = glm::vec3(0.0f);
+	glm::vec3 offset = 0.5f * (low + high);
+	glm::vec3 scale = glm::max(0.5f * (high - low), glm::vec3(1e-6f));
+	glm::vec3 invScale = 32767.0f / scale;
+
+	VertexCache::ChunkHeader chunk;
+	for (int k = 0; k < 3; k++) {
+		chunk.offset[k] = offset[k];
+		chunk.scale[k] = scale[k];
+	}
+	chunk.firstFrame = header.numFrames;
+	chunk.numFrames = numFrames;
+
+	this->Align();
+	chunkOffsets.push_back(position);
+	this->Write(&chunk, sizeof(chunk));
+
+	// each frame as the change of every quantized value since the frame
+	// before, positions first, then normals
+	GLint numValues = (header.normals ? 6 : 3) * numVertices;
+	previous.assign(numValues, 0);
+	encoded.resize(5 * (size_t)numValues);
+	for (const Frame& frame : chunkFrames) {
+		unsigned char* out = encoded.data();
+		GLint* last = previous.data();
+
+		for (GLint v = 0; v < numVertices; v++, last += 3) {
+			glm::vec3 p = frame.positions[v];
+			if (!std::isfinite(glm::dot(p, p))) p = offset;
+			glm::vec3 q = glm::clamp(glm::round((p - offset) * invScale),
+				glm::vec3(-32767.0f), glm::vec3(32767.0f));
+			for (int k = 0; k < 3; k++) {
+				GLint value = (GLint)q[k];
+				out = VertexCache::PutDelta(value - last[k], out);
+				last[k] = value;
+			}
+		}
+
+		if (header.normals) {
+			for (GLint v = 0; v < numVertices; v++, last += 3) {
+				glm::vec3 n = frame.normals[v];
+				if (!std::isfinite(glm::dot(n, n))) n = glm::vec3(0.0f);
+				glm::vec3 q = glm::round(glm::clamp(n, glm::vec3(-1.0f), glm::vec3(1.0f)) * 511.0f);
+				for (int k = 0; k < 3; k++) {
+					GLint value = (GLint)q[k];
+					out = VertexCache::PutDelta(value - last[k], out);
+					last[k] = value;
+				}
+			}
+		}
+
+		this->Write(encoded.data(), out - encoded.data());
+	}
+
+	header.numFrames += numFrames;
+	header.numChunks++;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (Frame& frame : chunkFrames) spare.push_back(std::move(frame));
+	chunkFrames.clear();
+}
+
+void VertexCacheWriter::Write(const void* data, size_t bytes) {
+	if (!failed && bytes > 0 && fwrite(data, bytes, 1, file) != 1) this->failed = true;
+	position += bytes;
+}
+
+// zeros up to the next chunk boundary
+void VertexCacheWriter::Align() {
+	static const unsigned char padding[chunkAlignment] = {};
+	this->Write(padding, (size_t)((chunkAlignment - position % chunkAlignment) % chunkAlignment));
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "VertexCache.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+/*
+* Streams the frames of a simulation to a VertexCache file while it runs.
+* AddFrame only copies the frame into a buffer and hands it over; a
+* background thread quantizes and delta codes whole chunks and writes
+* them, so the simulation never waits on the disk. Buffers are recycled
+* once written, and more are allocated whenever the disk falls behind.
+*/
+class VertexCacheWriter
+{
+public:
+	VertexCacheWriter();
+	~VertexCacheWriter();
+
+	bool Open(const std::string& path, GLint numVertices, const std::vector<unsigned int>& indices,
+		GLfloat frameTime, bool withNormals, GLint framesPerChunk = 32);
+	void AddFrame(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals);
+	bool Close();
+
+	bool isOpen() const { return file != nullptr; }
+
+private:
+	struct Frame {
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+	};
+
+	FILE* file;
+	VertexCache::Header header;
+	bool failed;				// a write went wrong, only seen by the I/O thread
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<Frame> queued;	// handed over by AddFrame, oldest first
+	std::vector<Frame> spare;	// written frames, to be filled again
+	bool closing;
+
+	// the I/O thread's own state: frames of the chunk being collected,
+	// each chunk's file offset, and room for a chunk's encoded frames
+	std::vector<Frame> chunkFrames;
+	std::vector<unsigned long long> chunkOffsets;
+	std::vector<GLint> previous;
+	std::vector<unsigned char> encoded;
+	unsigned long long position;
+
+	void Run();
+	void WriteChunk();
+	void Write(const void* data, size_t bytes);
+	void Align();
+};
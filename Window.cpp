@@ -3,6 +3,7 @@
 ////////////////////////////////////////
 
 #include "Window.h"
+#include "Scene.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -24,16 +25,20 @@ int MouseX, MouseY;
 
 // The shader program id
 GLuint Window::shaderProgram;
+ShaderUniforms Window::shaderUniforms;
 
 TwBar* Window::bar;
 
+// when the current frame's display callback started (Profiler::Now)
+long long FrameStart;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 // Constructors and desctructors 
 bool Window::initializeProgram() {
 
 	// Create a shader program with a vertex shader and a fragment shader.
-	shaderProgram = LoadShaders("shaders/shader.vert", "shaders/shader.frag");
+	shaderProgram = LoadShaders("shaders/shader.vert", "shaders/shader.frag", &shaderUniforms);
 
 	// Check the shader program.
 	if (!shaderProgram)
@@ -52,14 +57,26 @@ bool Window::initializeProgram() {
 	return true;
 }
 
-bool Window::initializeObjects()
+bool Window::initializeObjects(const char* scenePath)
 {
 	// Create a cube
 	cube = new Cube();
 	//cube = new Cube(glm::vec3(-1, 0, -2), glm::vec3(1, 1, 1));
 
-	// Create the cloth with 4g mass (0.04 newtons)
-	cloth = new Cloth(3.0f, 3.0f, 30, 30, glm::vec3(-1.5f, 1.5f, 0.0f), 0.6f, 0.0f);
+	// Create the cloths the scene describes (scenes/default.scene is a 3x3
+	// sheet of 30x30 particles weighing 0.6kg)
+	Scene scene;
+	if (!scene.Load(scenePath)) return false;
+	cloth = new Cloth(scene);
+	cloth->simulation.meshColliders.push_back(&cube->collider);
+	cloth->SetThreaded(true);
+
+	// rolling per-phase frame timings, press P to dump a trace of them
+	Profiler& profiler = Profiler::Shared();
+	for (int p = 0; p < PHASE_COUNT; p++) {
+		std::string name = std::string(Profiler::PhaseName((ProfilePhase)p)) + " ms";
+		TwAddVarRO(bar, name.c_str(), TW_TYPE_FLOAT, &profiler.averages[p], "group=Profiler precision=3");
+	}
 
 	return true;
 }
@@ -172,19 +189,32 @@ void Window::idleCallback()
 	Cam->Update();
 
 	//cube->update();
-	
-	cloth->Update();
+
+	// simulate as much time as actually passed since the last frame
+	static double lastTime = glfwGetTime();
+	double currentTime = glfwGetTime();
+	cloth->Advance((GLfloat)(currentTime - lastTime));
+	lastTime = currentTime;
+
+	// a frame is one display plus one idle callback
+	Profiler& profiler = Profiler::Shared();
+	if (profiler.enabled) {
+		profiler.Record(PHASE_FRAME, FrameStart, profiler.Now());
+	}
+	profiler.EndFrame();
 }
 
 void Window::displayCallback(GLFWwindow* window)
 {	
+	FrameStart = Profiler::Shared().Now();
+
 	// Clear the color and depth buffers.
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);	
 
 	// Render the object.
-	cube->draw(Cam->GetViewProjectMtx(), Window::shaderProgram);
+	cube->draw(Cam->GetViewProjectMtx(), Window::shaderProgram, Window::shaderUniforms);
 
-	cloth->Draw(Cam->GetViewProjectMtx(), Window::shaderProgram);
+	cloth->Draw(Cam->GetViewProjectMtx(), Window::shaderProgram, Window::shaderUniforms);
 
 	// Gets events, including input such as keyboard and mouse or window resizing.
 	glfwPollEvents();
@@ -226,35 +256,45 @@ void Window::keyCallback(GLFWwindow* window, int key, int scancode, int action,
 		case GLFW_KEY_R:
 			resetCamera();
 			break;
-		case GLFW_KEY_D:
-			for (unsigned int i = 0; i < cloth->particlesW; i++) {
-				cloth->particles[i]->updateFixedPos(glm::vec3(moveDist, 0.0f, 0.0f));
+		case GLFW_KEY_T:
+			// toggle running the simulation on its own thread
+			cloth->SetThreaded(!cloth->simulationThread.isRunning());
+			break;
+		case GLFW_KEY_P:
+			// open in chrome://tracing or ui.perfetto.dev
+			if (Profiler::Shared().WriteChromeTrace("trace.json")) {
+				std::cout << "Wrote trace.json" << std::endl;
+			}
+			else {
+				std::cerr << "Could not write trace.json" << std::endl;
 			}
 			break;
-		case GLFW_KEY_A:
-			for (unsigned int i = 0; i < cloth->particlesW; i++) {
-				cloth->particles[i]->updateFixedPos(glm::vec3(-moveDist, 0.0f, 0.0f));
+		case GLFW_KEY_V:
+			// play back a bake from the headless runner, or go back to simulating
+			if (cloth->isPlaying()) {
+				cloth->StopPlaying();
+			}
+			else if (!cloth->Play("cloth.vcache")) {
+				std::cerr << "Could not play cloth.vcache" << std::endl;
 			}
 			break;
+		case GLFW_KEY_D:
+			cloth->MoveFixedParticles(glm::vec3(moveDist, 0.0f, 0.0f));
+			break;
+		case GLFW_KEY_A:
+			cloth->MoveFixedParticles(glm::vec3(-moveDist, 0.0f, 0.0f));
+			break;
 		case GLFW_KEY_W:
-			for (unsigned int i = 0; i < cloth->particlesW; i++) {
-				cloth->particles[i]->updateFixedPos(glm::vec3(0.0f, 0.0f, -moveDist));
-			}
+			cloth->MoveFixedParticles(glm::vec3(0.0f, 0.0f, -moveDist));
 			break;
 		case GLFW_KEY_S:
-			for (unsigned int i = 0; i < cloth->particlesW; i++) {
-				cloth->particles[i]->updateFixedPos(glm::vec3(0.0f, 0.0f, moveDist));
-			}
+			cloth->MoveFixedParticles(glm::vec3(0.0f, 0.0f, moveDist));
 			break;
 		case GLFW_KEY_UP:
-			for (unsigned int i = 0; i < cloth->particlesW; i++) {
-				cloth->particles[i]->updateFixedPos(glm::vec3(0.0f, moveDist, 0.0f));
-			}
+			cloth->MoveFixedParticles(glm::vec3(0.0f, moveDist, 0.0f));
 			break;
 		case GLFW_KEY_DOWN:
-			for (unsigned int i = 0; i < cloth->particlesW; i++) {
-				cloth->particles[i]->updateFixedPos(glm::vec3(0.0f, -moveDist, 0.0f));
-			}
+			cloth->MoveFixedParticles(glm::vec3(0.0f, -moveDist, 0.0f));
 			break;
 		default:
 			break;
@@ -6,6 +6,7 @@
 #include "Cloth.h"
 #include "shader.h"
 #include "Camera.h"
+#include "Profiler.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -21,14 +22,15 @@ public:
 	static Cube* cube;
 	static Cloth* cloth;
 
-	// Shader Program 
+	// Shader Program and its uniforms' locations
 	static GLuint shaderProgram;
+	static ShaderUniforms shaderUniforms;
 
 	static TwBar* Window::bar;
 
 	// Act as Constructors and desctructors 
 	static bool initializeProgram();
-	static bool initializeObjects();
+	static bool initializeObjects(const char* scenePath);
 	static void cleanUp();
 
 	// for the Window
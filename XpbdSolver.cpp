@@ -0,0 +1,97 @@
+#include "XpbdSolver.h"
+
+// smallest number of loop iterations worth handing to another thread
+static const GLint parallelGrain = 512;
+
+/*
+* Constructor.
+*/
+XpbdSolver::XpbdSolver() {
+	this->iterations = 10;
+}
+
+/*
+* Takes one XPBD step. Forces already stored in particles.forces (gravity,
+* drag) only enter through the predicted positions, and are reset
+* afterwards like ParticleSystem::Integrate does.
+* 
+* particles: store to step forward
+* springs: colored spring-damper table (see SpringDamper::ColorTable)
+* springColors: start offsets of each color group in springs
+* deltaTime: the size of the time step to take forward in time
+*/
+void XpbdSolver::Step(ParticleSystem& particles, const std::vector<SpringDamper>& springs,
+	const std::vector<GLint>& springColors, GLfloat deltaTime) {
+	GLint numParticles = particles.size();
+	ThreadPool& pool = ThreadPool::Shared();
+
+	previousPositions.resize(numParticles);
+	springLambdas.assign(springs.size(), 0.0f);
+
+	// predict positions from the accumulated forces
+	pool.ParallelFor(numParticles, parallelGrain, [&](int begin, int end) {
+		for (GLint i = begin; i < end; i++) {
+			previousPositions[i] = particles.positions[i];
+			if (particles.pinned[i]) continue;
+
+			particles.velocities[i] += particles.inverseMasses[i] * particles.forces[i] * deltaTime;
+			particles.positions[i] += particles.velocities[i] * deltaTime;
+		}
+	});
+
+	// project constraints. Spring-dampers of one color don't share
+	// particles, so each color is a parallel Gauss-Seidel sweep
+	for (GLint iteration = 0; iteration < iterations; iteration++) {
+		for (size_t c = 0; c + 1 < springColors.size(); c++) {
+			GLint first = springColors[c];
+			pool.ParallelFor(springColors[c + 1] - first, parallelGrain,
+				[&, first](int begin, int end) {
+					for (GLint s = first + begin; s < first + end; s++) {
+						SolveConstraint(particles, springs[s], springLambdas[s], deltaTime);
+					}
+				});
+		}
+	}
+
+	// velocities follow from how far the particles actually moved
+	pool.ParallelFor(numParticles, parallelGrain, [&](int begin, int end) {
+		for (GLint i = begin; i < end; i++) {
+			if (!particles.pinned[i]) {
+				particles.velocities[i] = (particles.positions[i] - previousPositions[i]) / deltaTime;
+			}
+			particles.forces[i] = glm::vec3(0.0f);
+		}
+	});
+}
+
+/*
+* Projects one distance constraint C = |x1 - x2| - restLength, with
+* compliance alpha = 1 / k and damping gamma = alpha * d / h.
+*/
+void XpbdSolver::SolveConstraint(ParticleSystem& particles, const SpringDamper& sd,
+	GLfloat& lambda, GLfloat deltaTime) {
+	GLfloat w1 = particles.pinned[sd.P1] ? 0.0f : particles.inverseMasses[sd.P1];
+	GLfloat w2 = particles.pinned[sd.P2] ? 0.0f : particles.inverseMasses[sd.P2];
+	if (w1 + w2 == 0.0f) return;
+
+	glm::vec3 x12 = particles.positions[sd.P1] - particles.positions[sd.P2];
+	GLfloat currentLength = glm::length(x12);
+	if (currentLength == 0.0f) return;
+	glm::vec3 n = x12 / currentLength;
+
+	GLfloat constraint = currentLength - sd.restLength;
+	GLfloat alpha = 1.0f / (sd.springConstant * deltaTime * deltaTime);
+	GLfloat gamma = alpha * sd.dampingConstant * deltaTime;
+
+	// rate of change of the constraint over this step, for damping
+	glm::vec3 moved = (particles.positions[sd.P1] - previousPositions[sd.P1]) -
+		(particles.positions[sd.P2] - previousPositions[sd.P2]);
+	GLfloat constraintRate = glm::dot(n, moved);
+
+	GLfloat deltaLambda = (-constraint - alpha * lambda - gamma * constraintRate) /
+		((1.0f + gamma) * (w1 + w2) + alpha);
+	lambda += deltaLambda;
+
+	particles.positions[sd.P1] += (w1 * deltaLambda) * n;
+	particles.positions[sd.P2] -= (w2 * deltaLambda) * n;
+}
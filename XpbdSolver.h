@@ -0,0 +1,30 @@
+#pragma once
+
+#include "SpringDamper.h"
+#include "ThreadPool.h"
+
+/*
+* Extended position based dynamics (Macklin et al., "XPBD: Position-Based
+* Simulation of Compliant Constrained Dynamics"). Every spring-damper is
+* treated as a distance constraint with compliance 1 / springConstant and
+* damping from its dampingConstant, so the same tables drive both this and
+* the force based integrators (bending springs included). Unconditionally
+* stable, so a handful of steps per frame is enough.
+*/
+class XpbdSolver
+{
+public:
+	GLint iterations;	// constraint projections per step
+
+	XpbdSolver();
+
+	void Step(ParticleSystem& particles, const std::vector<SpringDamper>& springs,
+		const std::vector<GLint>& springColors, GLfloat deltaTime);
+
+private:
+	std::vector<glm::vec3> previousPositions;
+	std::vector<GLfloat> springLambdas;
+
+	void SolveConstraint(ParticleSystem& particles, const SpringDamper& sd,
+		GLfloat& lambda, GLfloat deltaTime);
+};
@@ -0,0 +1,218 @@
+/*
+* Microbenchmarks for the simulation hot paths. Builds a cloth for each
+* grid size, times every phase of a step on its own and then whole frames
+* with each integrator, and prints nanoseconds per particle per substep
+* so results from different grid sizes can be compared directly.
+*
+* Build from the repository root with CLOTH_HEADLESS defined (see README).
+*/
+
+#include "../ClothSimulation.h"
+#include "../CpuFeatures.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+#include <string>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef std::chrono::steady_clock Clock;
+
+// one row of the results table, one value per grid size
+struct Row {
+	std::string name;
+	std::vector<double> nsPerParticle;
+};
+
+void print_usage()
+{
+	std::cout << "usage: cloth_benchmark [options]" << std::endl
+		<< "  -sizes N,N,...        square grid sizes (default 30,100,300,1000)" << std::endl
+		<< "  -time SECONDS         minimum time spent on each measurement (default 0.25)" << std::endl
+		<< "  -maxsubsteps N        explicit substep cap for the full frame runs (default 20)" << std::endl;
+}
+
+/*
+* Runs body once to warm up, then repeatedly until at least minSeconds
+* have passed.
+* 
+* body: code to time, returns how many substeps one call took
+* minSeconds: least amount of time to keep repeating body for
+* returns: average seconds per substep
+*/
+double time_it(const std::function<int()>& body, double minSeconds)
+{
+	body();
+
+	long long substeps = 0;
+	Clock::time_point start = Clock::now();
+	double elapsed = 0.0;
+	do {
+		substeps += body();
+		elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+	} while (elapsed < minSeconds);
+
+	return elapsed / (double)substeps;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	std::vector<int> sizes = { 30, 100, 300, 1000 };
+	double minSeconds = 0.25;
+	int maxSubsteps = 20;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-sizes" && i + 1 < argc) {
+			sizes.clear();
+			std::stringstream list(argv[++i]);
+			std::string item;
+			while (std::getline(list, item, ',')) sizes.push_back(atoi(item.c_str()));
+		}
+		else if (arg == "-time" && i + 1 < argc) {
+			minSeconds = atof(argv[++i]);
+		}
+		else if (arg == "-maxsubsteps" && i + 1 < argc) {
+			maxSubsteps = atoi(argv[++i]);
+		}
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	std::cout << "threads: " << ThreadPool::Shared().size() 
+		<< ", spring kernel: " << SpringKernel::InstructionSet()
+		<< ", triangle kernel: " << TriangleKernel::InstructionSet() << std::endl;
+
+	std::vector<Row> rows;
+	std::vector<std::string> columns;
+
+	for (size_t s = 0; s < sizes.size(); s++) {
+		int n = sizes[s];
+		if (n < 2) continue;
+		columns.push_back(std::to_string(n) + "x" + std::to_string(n));
+
+		ClothSimulation simulation(3.0f, 3.0f, n, n, 
+			glm::vec3(-1.5f, 1.5f, 0.0f), 0.6f, 0.0f);
+		const glm::vec3 wind(0.5f, 0.0f, 1.0f);
+		simulation.airVelocity = wind;
+		simulation.scheduler.maxSubsteps = maxSubsteps;
+
+		ParticleSystem& particles = simulation.particles;
+		const std::vector<SpringDamper>& springs = simulation.getSpringDampers();
+		const std::vector<Triangle*>& triangles = simulation.getTriangles();
+		GLint numParticles = particles.size();
+		GLfloat deltaTime = simulation.scheduler.fixedTimeStep / maxSubsteps;
+
+		SpringKernel springKernel;
+		springKernel.Build(springs);
+		TriangleKernel triangleKernel;
+		triangleKernel.Build(triangles);
+
+		// every measurement is one named body timed per substep
+		std::vector<std::pair<std::string, std::function<int()> > > benches;
+
+		benches.push_back(std::make_pair("SpringDamper::ComputeForce", std::function<int()>([&]() {
+			for (const SpringDamper& sd : springs) sd.ComputeForce(particles);
+			return 1;
+		})));
+		benches.push_back(std::make_pair("SpringKernel::Evaluate", std::function<int()>([&]() {
+			springKernel.Evaluate(particles, 0, springKernel.size());
+			return 1;
+		})));
+		benches.push_back(std::make_pair("Triangle::ComputeForce", std::function<int()>([&]() {
+			for (Triangle* t : triangles) t->ComputeForce();
+			return 1;
+		})));
+		benches.push_back(std::make_pair("TriangleKernel::Evaluate", std::function<int()>([&]() {
+			triangleKernel.Evaluate(particles, simulation.airVelocity, 0, triangleKernel.size());
+			return 1;
+		})));
+		benches.push_back(std::make_pair("ParticleSystem::Integrate", std::function<int()>([&]() {
+			for (GLint p = 0; p < numParticles; p++) particles.Integrate(p, deltaTime);
+			return 1;
+		})));
+		benches.push_back(std::make_pair("ComputeNormals", std::function<int()>([&]() {
+			simulation.ComputeNormals();
+			return 1;
+		})));
+		benches.push_back(std::make_pair("SelfCollision::Resolve", std::function<int()>([&]() {
+			simulation.selfCollision.Resolve(particles, triangles);
+			return 1;
+		})));
+
+		// all forces of one substep in each accumulation mode
+		const char* modeNames[] = { "ComputeForce serial", "ComputeForce colored", "ComputeForce gather" };
+		for (int mode = FORCE_SERIAL; mode <= FORCE_GATHER; mode++) {
+			benches.push_back(std::make_pair(modeNames[mode], std::function<int()>([&, mode]() {
+				simulation.forceMode = (ForceMode)mode;
+				simulation.ComputeForce(deltaTime);
+				return 1;
+			})));
+		}
+		// gravity and drag alone, as the implicit and xpbd integrators use them
+		benches.push_back(std::make_pair("ComputeExternalForce", std::function<int()>([&]() {
+			simulation.ComputeExternalForce();
+			return 1;
+		})));
+
+		// whole frames, divided by however many substeps each one took
+		const char* integratorNames[] = { "Update explicit", "Update implicit", "Update xpbd" };
+		for (int integrator = INTEGRATOR_EXPLICIT; integrator <= INTEGRATOR_XPBD; integrator++) {
+			benches.push_back(std::make_pair(integratorNames[integrator], std::function<int()>([&, integrator]() {
+				simulation.forceMode = FORCE_COLORED;
+				simulation.integrator = (Integrator)integrator;
+				simulation.Update();
+				return (int)simulation.lastSubsteps;
+			})));
+		}
+		// default force mode with a gust strong enough that drag matters
+		benches.push_back(std::make_pair("Update colored, strong wind", std::function<int()>([&]() {
+			simulation.forceMode = FORCE_COLORED;
+			simulation.integrator = INTEGRATOR_EXPLICIT;
+			simulation.airVelocity = 4.0f * wind;
+			simulation.Update();
+			simulation.airVelocity = wind;
+			return (int)simulation.lastSubsteps;
+		})));
+		benches.push_back(std::make_pair("Update explicit gather", std::function<int()>([&]() {
+			simulation.forceMode = FORCE_GATHER;
+			simulation.integrator = INTEGRATOR_EXPLICIT;
+			simulation.Update();
+			return (int)simulation.lastSubsteps;
+		})));
+
+		for (size_t b = 0; b < benches.size(); b++) {
+			if (rows.size() <= b) {
+				rows.push_back(Row());
+				rows[b].name = benches[b].first;
+			}
+
+			double seconds = time_it(benches[b].second, minSeconds);
+			rows[b].nsPerParticle.push_back(1e9 * seconds / numParticles);
+
+			// forces left over from a force-only bench shouldn't leak into the next
+			std::fill(particles.forces.begin(), particles.forces.end(), glm::vec3(0.0f));
+		}
+	}
+
+	// results table, ns per particle per substep
+	printf("\n%-28s", "ns/particle/substep");
+	for (const std::string& column : columns) printf("%12s", column.c_str());
+	printf("\n");
+	for (const Row& row : rows) {
+		printf("%-28s", row.name.c_str());
+		for (double ns : row.nsPerParticle) printf("%12.2f", ns);
+		printf("\n");
+	}
+
+	return 0;
+}
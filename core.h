@@ -1,19 +1,10 @@
 #ifndef _CORE_H_
 #define _CORE_H_
 
-#ifdef __APPLE__
-#include <OpenGL/gl3.h>
-#else
-#include <GL/glew.h>
-#endif
+#include "physics.h"
 
-#include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
-#include <vector>
-#include <ctype.h>
-
-#include <iostream>
 
 #include <AntTweakBar.h>
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,279 @@
+/*
+* Headless batch runner. Steps a cloth for a fixed number of frames with no
+* window, GL context or tweak bar and writes the result out as OBJ meshes,
+* for baking simulations on machines without a display.
+*
+* Build from the repository root with CLOTH_HEADLESS defined (see README).
+*/
+
+#include "../ClothSimulation.h"
+#include "../Profiler.h"
+#include "../Scene.h"
+#include "../Snapshot.h"
+#include "../VertexCacheWriter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+void print_usage()
+{
+	std::cout << "usage: cloth_headless [options]" << std::endl
+		<< "  -frames N             frames to simulate (default 100)" << std::endl
+		<< "  -particles L W        particles along length and width (default 30 30)" << std::endl
+		<< "  -integrator NAME      explicit, implicit or xpbd (default explicit)" << std::endl
+		<< "  -force NAME           serial, colored or gather (default colored)" << std::endl
+		<< "  -wind X Y Z           air velocity (default 0 0 0)" << std::endl
+		<< "  -scene FILE           build the cloths of a scene file; it replaces" << std::endl
+		<< "                        the four options above" << std::endl
+		<< "  -out FILE             obj written after the last frame (default cloth.obj)" << std::endl
+		<< "  -every K              also write FILE with the frame number every K frames" << std::endl
+		<< "  -trace FILE           write a Chrome trace of the last frames' phases" << std::endl
+		<< "  -cache FILE           stream every frame to a vertex cache for playback" << std::endl
+		<< "  -cachenormals         store normals in the cache too" << std::endl
+		<< "  -checkpoint K FILE    save a snapshot to FILE every K frames" << std::endl
+		<< "  -resume FILE          continue from a snapshot up to -frames; its layout" << std::endl
+		<< "                        and settings replace the options above" << std::endl;
+}
+
+/*
+* Writes the current particle positions, normals and triangles of the
+* cloth as a Wavefront OBJ file.
+* 
+* simulation: cloth to write
+* path: file to (over)write
+* returns: false if the file couldn't be written
+*/
+bool write_obj(const ClothSimulation& simulation, const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cerr << "Could not write " << path << std::endl;
+		return false;
+	}
+
+	const ParticleSystem& particles = simulation.particles;
+	for (const glm::vec3& p : particles.positions) {
+		file << "v " << p.x << " " << p.y << " " << p.z << "\n";
+	}
+	for (const glm::vec3& n : particles.normals) {
+		file << "vn " << n.x << " " << n.y << " " << n.z << "\n";
+	}
+
+	// obj indices start at 1
+	const std::vector<unsigned int>& indices = simulation.indices;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		unsigned int a = indices[i] + 1, b = indices[i + 1] + 1, c = indices[i + 2] + 1;
+		file << "f " << a << "//" << a << " " << b << "//" << b << " " << c << "//" << c << "\n";
+	}
+
+	return file.good();
+}
+
+/*
+* Inserts a zero padded frame number before the extension of path, so
+* "out/cloth.obj" becomes "out/cloth_00042.obj".
+*/
+std::string frame_path(const std::string& path, int frame)
+{
+	char number[16];
+	snprintf(number, sizeof(number), "_%05d", frame);
+
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+		return path + number;
+	}
+	return path.substr(0, dot) + number + path.substr(dot);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	int frames = 100;
+	int particlesL = 30, particlesW = 30;
+	int every = 0;
+	Integrator integrator = INTEGRATOR_EXPLICIT;
+	ForceMode forceMode = FORCE_COLORED;
+	glm::vec3 wind(0.0f);
+	std::string outPath = "cloth.obj";
+	std::string tracePath;
+	int checkpointEvery = 0;
+	std::string checkpointPath, resumePath;
+	std::string scenePath;
+	std::string cachePath;
+	bool cacheNormals = false;
+
+	// parse the command line, every option takes a fixed number of values
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		int remaining = argc - i - 1;
+
+		if (arg == "-frames" && remaining >= 1) {
+			frames = atoi(argv[++i]);
+		}
+		else if (arg == "-particles" && remaining >= 2) {
+			particlesL = atoi(argv[++i]);
+			particlesW = atoi(argv[++i]);
+		}
+		else if (arg == "-integrator" && remaining >= 1) {
+			std::string name = argv[++i];
+			if (name == "explicit") integrator = INTEGRATOR_EXPLICIT;
+			else if (name == "implicit") integrator = INTEGRATOR_IMPLICIT;
+			else if (name == "xpbd") integrator = INTEGRATOR_XPBD;
+			else { print_usage(); return 1; }
+		}
+		else if (arg == "-force" && remaining >= 1) {
+			std::string name = argv[++i];
+			if (name == "serial") forceMode = FORCE_SERIAL;
+			else if (name == "colored") forceMode = FORCE_COLORED;
+			else if (name == "gather") forceMode = FORCE_GATHER;
+			else { print_usage(); return 1; }
+		}
+		else if (arg == "-wind" && remaining >= 3) {
+			wind.x = (float)atof(argv[++i]);
+			wind.y = (float)atof(argv[++i]);
+			wind.z = (float)atof(argv[++i]);
+		}
+		else if (arg == "-scene" && remaining >= 1) {
+			scenePath = argv[++i];
+		}
+		else if (arg == "-out" && remaining >= 1) {
+			outPath = argv[++i];
+		}
+		else if (arg == "-every" && remaining >= 1) {
+			every = atoi(argv[++i]);
+		}
+		else if (arg == "-trace" && remaining >= 1) {
+			tracePath = argv[++i];
+		}
+		else if (arg == "-cache" && remaining >= 1) {
+			cachePath = argv[++i];
+		}
+		else if (arg == "-cachenormals") {
+			cacheNormals = true;
+		}
+		else if (arg == "-checkpoint" && remaining >= 2) {
+			checkpointEvery = atoi(argv[++i]);
+			checkpointPath = argv[++i];
+		}
+		else if (arg == "-resume" && remaining >= 1) {
+			resumePath = argv[++i];
+		}
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	if (frames < 0 || particlesL < 2 || particlesW < 2) {
+		print_usage();
+		return 1;
+	}
+
+	ClothSimulation* cloth = nullptr;
+	int firstFrame = 1;
+	if (!resumePath.empty()) {
+		Snapshot snapshot;
+		if (snapshot.Open(resumePath)) cloth = snapshot.CreateSimulation();
+		if (!cloth) {
+			std::cerr << "Could not resume from " << resumePath << std::endl;
+			return 1;
+		}
+		firstFrame = snapshot.getHeader().frame + 1;
+	}
+	else if (!scenePath.empty()) {
+		Scene scene;
+		if (!scene.Load(scenePath.c_str())) return 1;
+		cloth = scene.CreateSimulation();
+	}
+	else {
+		// same piece of fabric the interactive viewer starts with
+		cloth = new ClothSimulation(3.0f, 3.0f, particlesL, particlesW, 
+			glm::vec3(-1.5f, 1.5f, 0.0f), 0.6f, 0.0f, integrator);
+		cloth->forceMode = forceMode;
+		cloth->airVelocity = wind;
+	}
+	ClothSimulation& simulation = *cloth;
+
+	// written on its own thread while the frames are simulated
+	VertexCacheWriter cache;
+	if (!cachePath.empty() && !cache.Open(cachePath, simulation.particles.size(), simulation.indices,
+		simulation.scheduler.fixedTimeStep, cacheNormals)) {
+		std::cerr << "Could not write " << cachePath << std::endl;
+		return 1;
+	}
+
+	// only pay for the timers when asked to
+	Profiler& profiler = Profiler::Shared();
+	profiler.enabled = !tracePath.empty();
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	double writeSeconds = 0.0;
+	long long totalSubsteps = 0;
+
+	for (int frame = firstFrame; frame <= frames; frame++) {
+		long long frameStart = profiler.Now();
+		simulation.Update();
+		totalSubsteps += simulation.lastSubsteps;
+		if (profiler.enabled) profiler.Record(PHASE_FRAME, frameStart, profiler.Now());
+		profiler.EndFrame();
+
+		if (cache.isOpen()) cache.AddFrame(simulation.particles.positions, simulation.particles.normals);
+
+		if (every > 0 && frame % every == 0) {
+			Clock::time_point writeStart = Clock::now();
+			if (!write_obj(simulation, frame_path(outPath, frame))) return 1;
+			writeSeconds += std::chrono::duration<double>(Clock::now() - writeStart).count();
+		}
+
+		if (checkpointEvery > 0 && frame % checkpointEvery == 0) {
+			Clock::time_point writeStart = Clock::now();
+			if (!Snapshot::Write(simulation, frame, checkpointPath)) {
+				std::cerr << "Could not write " << checkpointPath << std::endl;
+				return 1;
+			}
+			writeSeconds += std::chrono::duration<double>(Clock::now() - writeStart).count();
+		}
+	}
+	int simulatedFrames = frames >= firstFrame ? frames - firstFrame + 1 : 0;
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count() - writeSeconds;
+
+	if (!write_obj(simulation, outPath)) return 1;
+
+	if (cache.isOpen()) {
+		if (!cache.Close()) {
+			std::cerr << "Could not write " << cachePath << std::endl;
+			return 1;
+		}
+		std::cout << "Wrote " << cachePath << std::endl;
+	}
+
+	std::cout << "Simulated " << simulatedFrames << " frames of " << simulation.particles.size() 
+		<< " particles (" << totalSubsteps << " substeps) in " << seconds << " s" << std::endl;
+	if (simulatedFrames > 0) {
+		std::cout << "  " << 1000.0 * seconds / simulatedFrames << " ms/frame" << std::endl;
+	}
+	std::cout << "Wrote " << outPath << std::endl;
+
+	if (!tracePath.empty()) {
+		if (!profiler.WriteChromeTrace(tracePath.c_str())) {
+			std::cerr << "Could not write " << tracePath << std::endl;
+			return 1;
+		}
+		std::cout << "Wrote " << tracePath << std::endl;
+	}
+
+	delete cloth;
+	return 0;
+}
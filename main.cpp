@@ -54,8 +54,11 @@ void print_versions()
 
 ////////////////////////////////////////////////////////////////////////////////
 
-int main(void)
+int main(int argc, char* argv[])
 {
+	// The scene to load can be given on the command line.
+	const char* scenePath = argc > 1 ? argv[1] : "scenes/default.scene";
+
 	// Create the GLFW window.
 	GLFWwindow* window = Window::createWindow(800, 600);
 	if (!window) exit(EXIT_FAILURE);
@@ -70,7 +73,7 @@ int main(void)
 	// Initialize the shader program; exit if initialization fails.
 	if (!Window::initializeProgram()) exit(EXIT_FAILURE);
 	// Initialize objects/pointers for rendering; exit if initialization fails.
-	if (!Window::initializeObjects()) exit(EXIT_FAILURE);
+	if (!Window::initializeObjects(scenePath)) exit(EXIT_FAILURE);
 	
 	// Loop while GLFW window should stay open.
 	while (!glfwWindowShouldClose(window))
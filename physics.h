@@ -0,0 +1,29 @@
+#ifndef _PHYSICS_H_
+#define _PHYSICS_H_
+
+/*
+* Everything the simulation code needs, and nothing that needs a window or
+* a GL context. Build with CLOTH_HEADLESS defined to compile the physics
+* without any OpenGL headers at all (see the headless tool).
+*/
+
+#ifdef CLOTH_HEADLESS
+typedef float GLfloat;
+typedef int GLint;
+typedef unsigned int GLuint;
+typedef short GLshort;
+#else
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#endif
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <ctype.h>
+
+#include <iostream>
+
+#endif
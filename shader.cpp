@@ -61,7 +61,8 @@ GLuint LoadSingleShader(const char * shaderFilePath, ShaderType type)
 	return shaderID;
 }
 
-GLuint LoadShaders(const char * vertexFilePath, const char * fragmentFilePath) 
+GLuint LoadShaders(const char * vertexFilePath, const char * fragmentFilePath, 
+	ShaderUniforms * uniforms) 
 {
 	// Create the vertex shader and fragment shader.
 	GLuint vertexShaderID = LoadSingleShader(vertexFilePath, vertex);
@@ -103,5 +104,15 @@ GLuint LoadShaders(const char * vertexFilePath, const char * fragmentFilePath)
 	glDeleteShader(vertexShaderID);
 	glDeleteShader(fragmentShaderID);
 
+	// Look up the uniform locations once, for the draws to reuse.
+	if (uniforms)
+	{
+		uniforms->viewProj = glGetUniformLocation(programID, "viewProj");
+		uniforms->model = glGetUniformLocation(programID, "model");
+		uniforms->diffuseColor = glGetUniformLocation(programID, "DiffuseColor");
+		uniforms->positionOffset = glGetUniformLocation(programID, "PositionOffset");
+		uniforms->positionScale = glGetUniformLocation(programID, "PositionScale");
+	}
+
 	return programID;
 }
@@ -14,6 +14,19 @@
 #include <fstream>
 #include <algorithm>
 
-GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_path);
+// Locations of the uniforms the meshes set on every draw, looked up once
+// when the program is linked instead of by name on each draw (-1 for any
+// the shaders don't use).
+struct ShaderUniforms
+{
+	GLint viewProj;
+	GLint model;
+	GLint diffuseColor;
+	GLint positionOffset;
+	GLint positionScale;
+};
+
+GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_path, 
+	ShaderUniforms * uniforms = NULL);
 
 #endif
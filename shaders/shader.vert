@@ -8,6 +8,11 @@ layout (location = 1) in vec3 normal;
 uniform mat4 viewProj;
 uniform mat4 model;
 
+// meshes with quantized positions send their bounds, everyone else 
+// keeps these defaults
+uniform vec3 PositionOffset = vec3(0);
+uniform vec3 PositionScale = vec3(1);
+
 // Outputs of the vertex shader are the inputs of the same name of the fragment shader.
 // The default output, gl_Position, should be assigned something. 
 out vec3 fragNormal;
@@ -16,7 +21,7 @@ out vec3 fragNormal;
 void main()
 {
     // OpenGL maintains the D matrix so you only need to multiply by P, V (aka C inverse), and M
-    gl_Position = viewProj * model * vec4(position, 1.0);
+    gl_Position = viewProj * model * vec4(PositionOffset + position * PositionScale, 1.0);
 
     // for shading
 	fragNormal = vec3(model * vec4(normal, 0));